@@ -1,4 +1,4 @@
-QT += quick core gui widgets
+QT += quick core gui widgets multimedia
 CONFIG += c++11
 
 # The following define makes your compiler emit warnings if you use
@@ -13,16 +13,73 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+        cameraframesource.cpp \
+        cascadebackend.cpp \
+        cascadecache.cpp \
+        detectiongovernor.cpp \
+        detectionworker.cpp \
+        dnnfacebackend.cpp \
+        eyeflowtracker.cpp \
+        facedetectorbackend.cpp \
         facefeaturedetector.cpp \
+        fileframesource.cpp \
+        framepreprocessor.cpp \
+        framequeue.cpp \
+        frustumculler.cpp \
         glperspectivescene.cpp \
-        main.cpp
+        hotpathtrace.cpp \
+        ktxfile.cpp \
+        lumakernels.cpp \
+        main.cpp \
+        meshfile.cpp \
+        motiongate.cpp \
+        offaxisprojection.cpp \
+        perspectiverenderer.cpp \
+        posefilter.cpp \
+        pupilkernels.cpp \
+        pupillocator.cpp \
+        scene.cpp \
+        shadercache.cpp \
+        textureloader.cpp
 
 HEADERS += \
+    cameraframesource.h \
+    cascadebackend.h \
+    cascadecache.h \
+    detectiongovernor.h \
+    detectionworker.h \
+    dnnfacebackend.h \
+    eyeflowtracker.h \
+    facedetectorbackend.h \
     facefeaturedetector.h \
-    glperspectivescene.h
+    fileframesource.h \
+    framepreprocessor.h \
+    framequeue.h \
+    framesource.h \
+    frustumculler.h \
+    glperspectivescene.h \
+    headpose.h \
+    hotpathtrace.h \
+    ktxfile.h \
+    lumaframe.h \
+    lumakernels.h \
+    meshfile.h \
+    monotonicclock.h \
+    motiongate.h \
+    offaxisprojection.h \
+    perspectiverenderer.h \
+    posefilter.h \
+    pupilkernels.h \
+    pupillocator.h \
+    scene.h \
+    shadercache.h \
+    stagestats.h \
+    textureloader.h \
+    triplebuffer.h
 
 RESOURCES += qml.qrc \
     cascades.qrc \
+    scene.qrc \
     shaders.qrc \
     textures.qrc
 
@@ -37,6 +94,20 @@ qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
+# Headless benchmarks built with the app on desktop: detection replay (bench/replaybench.pro),
+# offscreen rendering (bench/renderbench.pro), the projection math (bench/projectionbench.pro),
+# the pupil localization (bench/pupilbench.pro), the object count sweep (bench/scenebench.pro), the detection
+# preprocessing (bench/preprocessbench.pro) and the steady state allocations of the capture and detection loop around
+# the cascades (bench/allocationbench.pro)
+unix:!android {
+    for(bench, $$list(replaybench renderbench projectionbench pupilbench scenebench preprocessbench allocationbench)) {
+        $${bench}.commands = $$QMAKE_QMAKE $$shell_quote($$PWD/bench/$${bench}.pro) -o $$shell_quote($$OUT_PWD/$$bench/Makefile) \
+            && $(MAKE) -C $$shell_quote($$OUT_PWD/$$bench)
+        QMAKE_EXTRA_TARGETS += $$bench
+        POST_TARGETDEPS += $$bench
+    }
+}
+
 ######################################### INCLUDING OPENCV ###########################################
 ## This project is pre-configured with these kits: arm64-v8a, armeabi-v7a, minGW 64-bit, MSVC2017 64bit, UWP 64bit (all downloaded with Qt)
 OPENCV_ANDROID = E:/OpenCV/OpenCV-4.0.1-android-sdk ##This must be changed to where YOU put OpenCV
@@ -66,6 +137,8 @@ android {
             -lopencv_core \
             -lopencv_imgproc \
             -lopencv_highgui \
+            -lopencv_video \
+            -lopencv_videoio \
             -lopencv_objdetect
 
         ANDROID_EXTRA_LIBS += $$OPENCV_ANDROID/sdk/native/libs/$$TARGET_ARCHITECTURE/libopencv_java4.so \
@@ -0,0 +1,248 @@
+#include <QCoreApplication>
+#include <QVideoFrame>
+#include <QDebug>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include "cameraframesource.h"
+#include "detectionworker.h"
+#include "framepreprocessor.h"
+#include "framequeue.h"
+#include "headpose.h"
+#include "triplebuffer.h"
+
+static std::atomic<quint64> allocations{0};
+
+#ifdef __GLIBC__
+// cv::Mat storage comes from cv::fastMalloc (posix_memalign or malloc), not from operator new: count the C allocator,
+// which operator new ends up in too
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+void *malloc(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **p, size_t alignment, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)))
+        return EINVAL;
+    *p = __libc_memalign(alignment, size);
+    return *p ? 0 : ENOMEM;
+}
+}
+#else
+// only the C++ allocations are seen here, not the cv::Mat buffers
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+#endif
+
+/**
+ * @brief The FixedFaceBackend class : stands in for the cascades, whose OpenCV internals allocate and are not covered.
+ * Always finds the same face and eyes, so everything around the detector runs on every frame.
+ */
+class FixedFaceBackend : public FaceDetectorBackend
+{
+public:
+    Kind kind() const override { return Haar; }
+    bool isReady() const override { return true; }
+
+    bool findFace(const cv::Mat &, const cv::Rect &window, const cv::Size &, const cv::Size &, cv::Rect &face) override {
+        face = cv::Rect(60, 80, 120, 120);
+        return (window & face) == face;
+    }
+
+    bool findEyes(const cv::Mat &, const cv::Rect &face, cv::Rect2f &leftEye, cv::Rect2f &rightEye) override {
+        leftEye = cv::Rect2f(face.x + face.width * 0.2f, face.y + face.height * 0.3f, face.width * 0.2f, face.height * 0.2f);
+        rightEye = cv::Rect2f(face.x + face.width * 0.6f, face.y + face.height * 0.3f, face.width * 0.2f, face.height * 0.2f);
+        return true;
+    }
+};
+
+/**
+ * @brief memoryFrame : a video frame in memory, filled with noise, as a camera would deliver it
+ */
+static QVideoFrame memoryFrame(QVideoFrame::PixelFormat format, int width, int height, int bytesPerPixel) {
+    QVideoFrame frame(width * height * bytesPerPixel * 3 / 2, QSize(width, height), width * bytesPerPixel, format);
+    frame.map(QAbstractVideoBuffer::WriteOnly);
+    cv::Mat bytes(1, frame.mappedBytes(), CV_8UC1, frame.bits());
+    cv::randu(bytes, cv::Scalar::all(0), cv::Scalar::all(256));
+    frame.unmap();
+    return frame;
+}
+
+/**
+ * @brief allocationsPerFrame : run a stage until its buffers are warm, then count what it allocates
+ * @return heap allocations per frame in the steady state
+ */
+static double allocationsPerFrame(const std::function<void()> &stage) {
+    const int warmup = 10, frames = 200;
+    for (int i = 0; i < warmup; i++)
+        stage();
+
+    quint64 before = allocations.load();
+    for (int i = 0; i < frames; i++)
+        stage();
+    return double(allocations.load() - before) / frames;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const cv::Size detection(240, 320);
+    int failures = 0;
+    auto check = [&failures](const char *stage, double perFrame) {
+        qDebug().nospace() << stage << ": " << perFrame << " allocations/frame";
+        if (perFrame > 0.0)
+            failures++;
+    };
+
+    //camera buffers, wrapped like CameraFrameSource does
+    cv::Mat bgra(480, 640, CV_8UC4), luma(480, 640, CV_8UC1), lumaSmall(240, 320, CV_8UC1);
+    cv::randu(bgra, cv::Scalar::all(0), cv::Scalar::all(256));
+    cv::randu(luma, cv::Scalar::all(0), cv::Scalar::all(256));
+    cv::randu(lumaSmall, cv::Scalar::all(0), cv::Scalar::all(256));
+
+    for (bool equalize : {false, true}) {
+        FramePreprocessor preprocessor;
+        preprocessor.setEqualizeHistogram(equalize);
+
+        LumaFrame bgraFrame;
+        bgraFrame.bgra = cv::Mat(bgra.rows, bgra.cols, CV_8UC4, bgra.data, bgra.step);
+        bgraFrame.orientation = -90;
+        check(equalize ? "preprocess BGRA /2 + equalize" : "preprocess BGRA /2", allocationsPerFrame([&]() {
+            preprocessor.process(bgraFrame, detection);
+        }));
+
+        LumaFrame lumaFrame;
+        lumaFrame.gray = cv::Mat(luma.rows, luma.cols, CV_8UC1, luma.data, luma.step);
+        lumaFrame.orientation = -90;
+        check(equalize ? "preprocess luma /2 + equalize" : "preprocess luma /2", allocationsPerFrame([&]() {
+            preprocessor.process(lumaFrame, detection);
+        }));
+
+        //a reduced size of the DetectionGovernor, not a multiple of the camera frame: area kernels
+        const cv::Size reduced(180, 240);
+        check(equalize ? "preprocess BGRA area + equalize" : "preprocess BGRA area", allocationsPerFrame([&]() {
+            preprocessor.process(bgraFrame, reduced);
+        }));
+        check(equalize ? "preprocess luma area + equalize" : "preprocess luma area", allocationsPerFrame([&]() {
+            preprocessor.process(lumaFrame, reduced);
+        }));
+
+        lumaFrame.gray = cv::Mat(lumaSmall.rows, lumaSmall.cols, CV_8UC1, lumaSmall.data, lumaSmall.step);
+        check(equalize ? "preprocess luma /1 + equalize" : "preprocess luma /1", allocationsPerFrame([&]() {
+            preprocessor.process(lumaFrame, detection);
+        }));
+    }
+
+    for (FrameQueue::BackpressurePolicy policy : {FrameQueue::LatestOnly, FrameQueue::DropOldest, FrameQueue::DropNewest}) {
+        FrameQueue queue(2, policy);
+        LumaFrame frame, popped;
+        frame.gray = lumaSmall;
+        check("frame queue push/pop", allocationsPerFrame([&]() {
+            queue.push(frame);
+            queue.push(frame);
+            queue.push(frame);
+            while (queue.pop(popped)) {}
+        }));
+    }
+
+    TripleBuffer<HeadPose> poses;
+    HeadPose pose;
+    pose.state = HeadPose::FaceAndEyes;
+    check("pose publish/read", allocationsPerFrame([&]() {
+        pose.sequence++;
+        poses.publish(pose);
+        volatile quint64 seen = poses.read().sequence;
+        Q_UNUSED(seen);
+    }));
+
+    //the whole detection loop around the detector: preprocessing, motion gate, pupils, distance, publish.
+    //The optical flow is left out with the cascades, cv::calcOpticalFlowPyrLK allocates internally.
+    cv::Mat inverted = 255 - luma;
+    LumaFrame frames[2];
+    frames[0].gray = cv::Mat(luma.rows, luma.cols, CV_8UC1, luma.data, luma.step);
+    frames[1].gray = cv::Mat(inverted.rows, inverted.cols, CV_8UC1, inverted.data, inverted.step);
+    for (bool moving : {true, false}) {
+        DetectionWorker worker(QSize(detection.width, detection.height), poses);
+        TrackingSettings settings;
+        settings.eyeFlowTracking = false;
+        settings.detectionThreads = 1;
+        worker.setBackend(new FixedFaceBackend);
+        worker.setTrackingSettings(settings);
+
+        quint64 sequence = 0;
+        check(moving ? "processFrame (detected)" : "processFrame (motion gated)", allocationsPerFrame([&]() {
+            LumaFrame &frame = frames[moving ? sequence % 2 : 0];
+            frame.orientation = -90;
+            frame.sequence = ++sequence;
+            frame.timestampNs = qint64(sequence) * 33333333;
+            worker.processFrame(frame);
+        }));
+    }
+
+    //camera frames wrapped by the CameraFrameSource, held downstream for a frame like the detector queue does
+    QObject noCamera;
+    CameraFrameSource source(&noCamera, -90);
+    LumaFrame received;
+    QObject::connect(&source, &FrameSource::frameAvailable, [&received](const LumaFrame &frame) {
+        received = frame;
+    });
+    const struct { const char *name; QVideoFrame::PixelFormat format; int bytesPerPixel; } formats[] = {
+        {"camera NV21", QVideoFrame::Format_NV21, 1},
+        {"camera YUYV", QVideoFrame::Format_YUYV, 2},
+        {"camera UYVY", QVideoFrame::Format_UYVY, 2},
+        {"camera RGB32", QVideoFrame::Format_RGB32, 4}
+    };
+    for (const auto &format : formats) {
+        QVideoFrame cameraFrame = memoryFrame(format.format, 640, 480, format.bytesPerPixel);
+        check(format.name, allocationsPerFrame([&]() {
+            source.videoFrameProbed(cameraFrame);
+        }));
+        received = LumaFrame();
+    }
+
+    if (failures)
+        qDebug() << failures << "stage(s) allocate in the steady state";
+    return failures ? 1 : 0;
+}
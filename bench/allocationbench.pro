@@ -0,0 +1,57 @@
+# Counts heap allocations per frame in the steady state of the detection hot path, fails if any stage allocates.
+# Covers the preprocessing, the frame queue, the pose hand-off, DetectionWorker::processFrame around a stubbed
+# detector and the CameraFrameSource wrapping, not the cascades and the optical flow (OpenCV internals).
+# The C allocator is hooked on glibc, elsewhere only operator new is counted.
+QT += multimedia
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = allocationbench
+
+INCLUDEPATH += ..
+
+SOURCES += \
+        allocationbench.cpp \
+        ../cameraframesource.cpp \
+        ../cascadebackend.cpp \
+        ../cascadecache.cpp \
+        ../detectiongovernor.cpp \
+        ../detectionworker.cpp \
+        ../dnnfacebackend.cpp \
+        ../eyeflowtracker.cpp \
+        ../facedetectorbackend.cpp \
+        ../framepreprocessor.cpp \
+        ../framequeue.cpp \
+        ../hotpathtrace.cpp \
+        ../lumakernels.cpp \
+        ../motiongate.cpp \
+        ../pupilkernels.cpp \
+        ../pupillocator.cpp
+
+HEADERS += \
+    ../cameraframesource.h \
+    ../cascadebackend.h \
+    ../cascadecache.h \
+    ../detectiongovernor.h \
+    ../detectionworker.h \
+    ../dnnfacebackend.h \
+    ../eyeflowtracker.h \
+    ../facedetectorbackend.h \
+    ../framepreprocessor.h \
+    ../framequeue.h \
+    ../framesource.h \
+    ../headpose.h \
+    ../hotpathtrace.h \
+    ../lumaframe.h \
+    ../lumakernels.h \
+    ../monotonicclock.h \
+    ../motiongate.h \
+    ../pupilkernels.h \
+    ../pupillocator.h \
+    ../stagestats.h \
+    ../triplebuffer.h
+
+unix:!android {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += opencv4
+}
@@ -0,0 +1,101 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <opencv2/imgproc.hpp>
+#include <functional>
+#include "framepreprocessor.h"
+#include "lumakernels.h"
+
+/**
+ * @brief timePerFrame : run a preprocessing path many times
+ * @return average microseconds per frame
+ */
+static double timePerFrame(int iterations, const std::function<void()> &path) {
+    path(); //warm up the buffers
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; i++)
+        path();
+    return timer.nsecsElapsed() / 1e3 / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const int iterations = argc > 1 ? atoi(argv[1]) : 1000;
+    const int factor = argc > 2 ? atoi(argv[2]) : 2;
+    const cv::Size detection(240, 320); //upright size used by the app
+    const cv::Size camera(detection.height * factor, detection.width * factor); //landscape sensor
+
+    cv::Mat bgra(camera, CV_8UC4);
+    cv::randu(bgra, cv::Scalar::all(0), cv::Scalar::all(256));
+
+    cv::Mat gray, small, equalized, upright;
+    cv::Mat scalarOut(camera.height / factor, camera.width / factor, CV_8UC1);
+    cv::Mat vectorOut(scalarOut.size(), CV_8UC1);
+
+    for (bool equalize : {false, true}) {
+        //what the detector did before: full size conversion, resize, equalize, rotate as separate passes
+        double before = timePerFrame(iterations, [&]() {
+            cv::cvtColor(bgra, gray, cv::COLOR_BGRA2GRAY);
+            cv::resize(gray, small, cv::Size(camera.width / factor, camera.height / factor), 0, 0, cv::INTER_AREA);
+            const cv::Mat *img = &small;
+            if (equalize) {
+                cv::equalizeHist(small, equalized);
+                img = &equalized;
+            }
+            cv::rotate(*img, upright, cv::ROTATE_90_CLOCKWISE);
+        });
+
+        FramePreprocessor preprocessor;
+        preprocessor.setEqualizeHistogram(equalize);
+        LumaFrame frame;
+        frame.bgra = bgra;
+        frame.orientation = -90;
+        double after = timePerFrame(iterations, [&]() {
+            preprocessor.process(frame, detection);
+        });
+
+        qDebug().nospace() << (equalize ? "with" : "without") << " equalization: cvtColor + resize "
+                           << before << " us, FramePreprocessor " << after << " us, x" << before / after;
+    }
+
+    uint32_t *noHistogram = nullptr;
+    double scalar = timePerFrame(iterations, [&]() {
+        LumaKernels::bgraToLumaScalar(bgra.data, int(bgra.step), scalarOut.data, int(scalarOut.step),
+                                      scalarOut.cols, scalarOut.rows, factor, noHistogram);
+    });
+    double vector = timePerFrame(iterations, [&]() {
+        LumaKernels::bgraToLuma(bgra.data, int(bgra.step), vectorOut.data, int(vectorOut.step),
+                                vectorOut.cols, vectorOut.rows, factor, noHistogram);
+    });
+    bool identical = cv::countNonZero(scalarOut != vectorOut) == 0;
+
+    qDebug().nospace() << "kernel " << camera.width << "x" << camera.height << " /" << factor << ": scalar "
+                       << scalar << " us, " << LumaKernels::instructionSet() << " " << vector << " us, x"
+                       << scalar / vector << (identical ? ", identical output" : ", OUTPUT MISMATCH");
+
+    //the reduced sizes of the DetectionGovernor are no multiple of the camera frame, they take the area kernels
+    for (float level : {0.625f, 0.75f, 0.875f}) {
+        const cv::Size reduced(cvRound(detection.width * level), cvRound(detection.height * level));
+        double before = timePerFrame(iterations, [&]() {
+            cv::cvtColor(bgra, gray, cv::COLOR_BGRA2GRAY);
+            cv::resize(gray, small, cv::Size(reduced.height, reduced.width), 0, 0, cv::INTER_AREA);
+            cv::rotate(small, upright, cv::ROTATE_90_CLOCKWISE);
+        });
+
+        FramePreprocessor preprocessor;
+        LumaFrame frame;
+        frame.bgra = bgra;
+        frame.orientation = -90;
+        double after = timePerFrame(iterations, [&]() {
+            preprocessor.process(frame, reduced);
+        });
+
+        qDebug().nospace() << "level " << level << " (" << reduced.width << "x" << reduced.height << "): cvtColor + resize "
+                           << before << " us, FramePreprocessor " << after << " us, x" << before / after;
+    }
+
+    return identical ? 0 : 1;
+}
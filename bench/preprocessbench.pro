@@ -0,0 +1,23 @@
+# Microbenchmark of the detection preprocessing: the old cvtColor + resize path against the fused LumaKernels pass
+QT -= gui
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = preprocessbench
+
+INCLUDEPATH += ..
+
+SOURCES += \
+        preprocessbench.cpp \
+        ../framepreprocessor.cpp \
+        ../lumakernels.cpp
+
+HEADERS += \
+    ../framepreprocessor.h \
+    ../lumaframe.h \
+    ../lumakernels.h
+
+unix:!android {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += opencv4
+}
@@ -0,0 +1,96 @@
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QVector4D>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "offaxisprojection.h"
+
+/**
+ * @brief screenCorners : the screen rectangle PerspectiveRenderer::resize() builds for an aspect ratio
+ */
+static void screenCorners(float aspect, QVector3D &pa, QVector3D &pb, QVector3D &pc) {
+    float sceneWidth = 3.0f, sceneHeight = sceneWidth / aspect;
+    pa = QVector3D(-sceneWidth, -sceneHeight, 0.0f);
+    pb = QVector3D(sceneWidth, -sceneHeight, 0.0f);
+    pc = QVector3D(-sceneWidth, sceneHeight, 0.0f);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+    const float zNear = 0.1f;
+
+    //eye positions the tracker produces: in front of the screen, off to the sides
+    std::vector<QVector3D> eyes;
+    for (float x = -6.0f; x <= 6.0f; x += 1.5f)
+        for (float y = -6.0f; y <= 6.0f; y += 1.5f)
+            for (float z = 2.0f; z <= 20.0f; z += 3.0f)
+                eyes.push_back(QVector3D(x, y, z));
+
+    //accuracy: matrices and projected points of the scene box, over screen shapes and eyes
+    const float tolerance = 1e-4f;
+    double worstMatrix = 0.0, worstPoint = 0.0;
+    for (float aspect : {0.46f, 0.5f, 0.5625f, 0.75f, 1.0f, 1.7778f}) {
+        QVector3D pa, pb, pc;
+        screenCorners(aspect, pa, pb, pc);
+        OffAxisProjection projection;
+        projection.setScreen(pa, pb, pc);
+
+        for (const QVector3D &eye : eyes) {
+            const float zFar = eye.z() * 3.5f;
+            QMatrix4x4 reference = OffAxisProjection::projFrustum(pa, pb, pc, eye, zNear, zFar);
+            QMatrix4x4 fast = projection.matrix(eye, zNear, zFar);
+
+            double scale = 0.0, error = 0.0;
+            for (int i = 0; i < 16; i++) {
+                scale = std::max(scale, double(std::fabs(reference.constData()[i])));
+                error = std::max(error, double(std::fabs(reference.constData()[i] - fast.constData()[i])));
+            }
+            worstMatrix = std::max(worstMatrix, error / scale);
+
+            for (float x : {-1.0f, 1.0f})
+                for (float y : {-1.0f, 1.0f})
+                    for (float z : {-1.0f, 1.0f}) {
+                        QVector4D corner(x * pb.x(), y * pc.y(), z * 5.0f, 1.0f);
+                        QVector4D a = reference * corner, b = fast * corner;
+                        worstPoint = std::max(worstPoint, double((a - b).length() / std::max(1.0f, a.length())));
+                    }
+        }
+    }
+    qDebug().nospace() << "accuracy over " << eyes.size() * 6 << " eye/screen pairs: max relative matrix error "
+                       << worstMatrix << ", max clip space error " << worstPoint;
+
+    //speed: what paintGL used to do every frame against the cached screen basis
+    QVector3D pa, pb, pc;
+    screenCorners(0.48f, pa, pb, pc);
+    OffAxisProjection projection;
+    projection.setScreen(pa, pb, pc);
+
+    volatile float sink = 0.0f; //keeps the loops from being optimized away
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; i++) {
+        const QVector3D &eye = eyes[i % eyes.size()];
+        sink = sink + OffAxisProjection::projFrustum(pa, pb, pc, eye, zNear, eye.z() * 3.5f)(0, 2);
+    }
+    double generalNs = double(timer.nsecsElapsed()) / iterations;
+
+    timer.restart();
+    for (int i = 0; i < iterations; i++) {
+        const QVector3D &eye = eyes[i % eyes.size()];
+        sink = sink + projection.matrix(eye, zNear, eye.z() * 3.5f)(0, 2);
+    }
+    double cachedNs = double(timer.nsecsElapsed()) / iterations;
+
+    qDebug().nospace() << "projFrustum: " << generalNs << " ns, cached closed form: " << cachedNs << " ns ("
+                       << generalNs / cachedNs << "x)";
+
+    bool accurate = worstMatrix < tolerance && worstPoint < tolerance;
+    if (!accurate)
+        qDebug() << "cached projection differs from projFrustum";
+    return accurate ? 0 : 1;
+}
@@ -0,0 +1,15 @@
+# Microbenchmark and accuracy check of the cached off-axis projection against the general projFrustum
+QT += gui
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = projectionbench
+
+INCLUDEPATH += ..
+
+SOURCES += \
+        projectionbench.cpp \
+        ../offaxisprojection.cpp
+
+HEADERS += \
+    ../offaxisprojection.h
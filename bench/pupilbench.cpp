@@ -0,0 +1,166 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/objdetect.hpp>
+#include <cmath>
+#include <functional>
+#include <vector>
+#include "cascadecache.h"
+#include "pupilkernels.h"
+#include "pupillocator.h"
+
+/**
+ * @brief The SyntheticFace struct : a flat face with two eyes, the pupils at known sub-pixel positions
+ */
+struct SyntheticFace
+{
+    cv::Mat gray;
+    cv::Rect face;
+    cv::Point2f pupils[2];
+};
+
+/**
+ * @brief drawEye : sclera, iris and pupil, anti-aliased at sub-pixel precision
+ */
+static void drawEye(cv::Mat &img, const cv::Rect &region, const cv::Point2f &pupil, float irisRadius) {
+    const int shift = 4;
+    const float one = 1 << shift;
+    cv::Point center(cvRound(region.x + region.width * 0.5f), cvRound(region.y + region.height * 0.5f));
+    cv::ellipse(img, center, cv::Size(region.width * 2 / 5, region.height / 4), 0, 0, 360, cv::Scalar(225), cv::FILLED, cv::LINE_AA);
+    cv::Point p(cvRound(pupil.x * one), cvRound(pupil.y * one));
+    cv::circle(img, p, cvRound(irisRadius * one), cv::Scalar(95), cv::FILLED, cv::LINE_AA, shift);
+    cv::circle(img, p, cvRound(irisRadius * 0.45f * one), cv::Scalar(25), cv::FILLED, cv::LINE_AA, shift);
+}
+
+/**
+ * @brief makeFace : random face size, position and gaze, with camera noise
+ */
+static SyntheticFace makeFace(cv::RNG &rng) {
+    SyntheticFace sample;
+    sample.gray.create(320, 240, CV_8UC1);
+    sample.gray.setTo(cv::Scalar(120));
+
+    const int size = rng.uniform(80, 180);
+    sample.face = cv::Rect(rng.uniform(0, 240 - size), rng.uniform(0, 320 - size), size, size);
+    cv::ellipse(sample.gray, (sample.face.tl() + sample.face.br()) / 2, cv::Size(size * 2 / 5, size / 2), 0, 0, 360,
+                cv::Scalar(170), cv::FILLED, cv::LINE_AA);
+
+    const float gazeX = rng.uniform(-0.15f, 0.15f), gazeY = rng.uniform(-0.08f, 0.08f);
+    for (int i = 0; i < 2; i++) {
+        cv::Rect region = PupilLocator::eyeRegion(sample.face, i == 0);
+        sample.pupils[i] = cv::Point2f(region.x + region.width * (0.5f + gazeX), region.y + region.height * (0.5f + gazeY));
+        drawEye(sample.gray, region, sample.pupils[i], region.width * 0.16f);
+    }
+
+    cv::Mat noise(sample.gray.size(), CV_16SC1);
+    rng.fill(noise, cv::RNG::NORMAL, 0, 4);
+    cv::Mat noisy;
+    sample.gray.convertTo(noisy, CV_16SC1);
+    noisy += noise;
+    noisy.convertTo(sample.gray, CV_8UC1);
+    return sample;
+}
+
+/**
+ * @brief timePerCall : run a function many times
+ * @return average microseconds per call
+ */
+static double timePerCall(int iterations, const std::function<void()> &call) {
+    call(); //warm up the buffers
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; i++)
+        call();
+    return timer.nsecsElapsed() / 1e3 / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const int faces = argc > 1 ? atoi(argv[1]) : 200;
+    cv::RNG rng(0x5eed);
+    std::vector<SyntheticFace> samples;
+    for (int i = 0; i < faces; i++)
+        samples.push_back(makeFace(rng));
+
+    //accuracy, and the vector kernel against the reference on the same regions
+    PupilLocator locator, reference;
+    reference.setUseReference(true);
+    double errorSum = 0.0, errorMax = 0.0, distanceErrorSum = 0.0;
+    int located = 0, mismatches = 0;
+    for (const SyntheticFace &sample : samples) {
+        cv::Point2f found[2], expected[2];
+        if (!locator.locate(sample.gray, sample.face, found[0], found[1]))
+            continue;
+        if (!reference.locate(sample.gray, sample.face, expected[0], expected[1])
+                || cv::norm(found[0] - expected[0]) > 1e-3 || cv::norm(found[1] - expected[1]) > 1e-3)
+            mismatches++;
+        located++;
+        for (int i = 0; i < 2; i++) {
+            double error = cv::norm(found[i] - sample.pupils[i]);
+            errorSum += error;
+            errorMax = std::max(errorMax, error);
+        }
+        distanceErrorSum += std::abs((found[1].x - found[0].x) - (sample.pupils[1].x - sample.pupils[0].x));
+    }
+    qDebug().nospace() << "located " << located << " of " << faces << " faces, pupil error mean "
+                       << (located ? errorSum / (2 * located) : 0.0) << " px, max " << errorMax
+                       << " px, inter-pupil distance error mean " << (located ? distanceErrorSum / located : 0.0) << " px";
+
+    //the kernel alone on one eye region
+    const SyntheticFace &sample = samples.front();
+    cv::Mat eye, gx, gy, magnitude;
+    cv::Rect region = PupilLocator::eyeRegion(sample.face, true);
+    cv::resize(sample.gray(region), eye, cv::Size(40, cvRound(region.height * 40.0f / region.width)), 0, 0, cv::INTER_AREA);
+    cv::Sobel(eye, gx, CV_32F, 1, 0, 3);
+    cv::Sobel(eye, gy, CV_32F, 0, 1, 3);
+    cv::magnitude(gx, gy, magnitude);
+    cv::divide(gx, magnitude + 1e-3f, gx);
+    cv::divide(gy, magnitude + 1e-3f, gy);
+    cv::Mat scalarOut = cv::Mat::zeros(eye.size(), CV_32F), vectorOut = cv::Mat::zeros(eye.size(), CV_32F);
+    const int iterations = 200;
+    double scalar = timePerCall(iterations, [&]() {
+        PupilKernels::accumulateCentersScalar(gx.ptr<float>(), gy.ptr<float>(), int(gx.step1()), eye.cols, eye.rows,
+                                              scalarOut.ptr<float>(), int(scalarOut.step1()));
+    });
+    double vector = timePerCall(iterations, [&]() {
+        PupilKernels::accumulateCenters(gx.ptr<float>(), gy.ptr<float>(), int(gx.step1()), eye.cols, eye.rows,
+                                        vectorOut.ptr<float>(), int(vectorOut.step1()));
+    });
+    double relative = cv::norm(scalarOut, vectorOut, cv::NORM_INF) / cv::norm(scalarOut, cv::NORM_INF);
+    qDebug().nospace() << "kernel " << eye.cols << "x" << eye.rows << ", every gradient voting: scalar " << scalar
+                       << " us, " << PupilKernels::instructionSet() << " " << vector << " us, x" << scalar / vector
+                       << ", max relative difference " << relative;
+
+    //whole localization against the eye cascade it replaces, on the same faces
+    cv::CascadeClassifier eyeCascade;
+    if (!CascadeCache::load(eyeCascade, ":/haarcascade_eye.xml")) {
+        qDebug() << "Can't load the eye cascade";
+        return 1;
+    }
+    std::vector<cv::Rect> eyes;
+    size_t next = 0;
+    auto nextSample = [&]() -> const SyntheticFace & { return samples[next++ % samples.size()]; };
+    cv::Point2f left, right;
+    double pupils = timePerCall(faces, [&]() {
+        const SyntheticFace &s = nextSample();
+        locator.locate(s.gray, s.face, left, right);
+    });
+    double pupilsReference = timePerCall(faces, [&]() {
+        const SyntheticFace &s = nextSample();
+        reference.locate(s.gray, s.face, left, right);
+    });
+    double cascade = timePerCall(faces, [&]() {
+        const SyntheticFace &s = nextSample();
+        eyeCascade.detectMultiScale(s.gray(s.face), eyes, 1.1, 3, cv::CASCADE_DO_ROUGH_SEARCH);
+    });
+    qDebug().nospace() << "per face: eye cascade " << cascade << " us, pupils " << pupils << " us ("
+                       << PupilKernels::instructionSet() << "), " << pupilsReference << " us (scalar)";
+
+    bool ok = mismatches == 0 && relative < 1e-4;
+    if (mismatches)
+        qDebug() << mismatches << "faces where the vector and the scalar kernels disagree";
+    return ok ? 0 : 1;
+}
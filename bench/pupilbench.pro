@@ -0,0 +1,26 @@
+# Pupil localization: accuracy on synthetic eyes, SIMD kernel against its scalar reference, cost against the eye cascade
+QT -= gui
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = pupilbench
+
+INCLUDEPATH += ..
+
+SOURCES += \
+        pupilbench.cpp \
+        ../cascadecache.cpp \
+        ../pupilkernels.cpp \
+        ../pupillocator.cpp
+
+HEADERS += \
+    ../cascadecache.h \
+    ../pupilkernels.h \
+    ../pupillocator.h
+
+RESOURCES += ../cascades.qrc
+
+unix:!android {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += opencv4
+}
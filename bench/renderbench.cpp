@@ -0,0 +1,216 @@
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QFile>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QTextStream>
+#include <QVector3D>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+#include "monotonicclock.h"
+#include "perspectiverenderer.h"
+
+/**
+ * @brief The Trajectory struct : eye position in scene units for every frame of a scripted head movement
+ */
+struct Trajectory
+{
+    QString name;
+    std::vector<QVector3D> eyes;
+};
+
+/**
+ * @brief scripted : the head movements every run is measured on, at 60 frames per second
+ * @param frames : length of each trajectory
+ */
+static std::vector<Trajectory> scripted(int frames) {
+    const float pi = 3.14159265f;
+    std::vector<Trajectory> trajectories;
+    auto add = [&](const QString &name, const std::function<QVector3D(float)> &eye) {
+        Trajectory trajectory{name, {}};
+        for (int i = 0; i < frames; i++)
+            trajectory.eyes.push_back(eye(i / 60.0f));
+        trajectories.push_back(trajectory);
+    };
+
+    add("still", [](float) { return QVector3D(0.0f, 0.0f, 10.0f); });
+    add("sway", [pi](float t) { return QVector3D(4.0f * std::sin(2.0f * pi * 0.5f * t), 0.0f, 10.0f); });
+    add("nod", [pi](float t) { return QVector3D(0.0f, 3.0f * std::sin(2.0f * pi * 0.7f * t), 10.0f); });
+    add("approach", [pi](float t) { return QVector3D(0.0f, 0.0f, 10.0f + 6.0f * std::sin(2.0f * pi * 0.3f * t)); });
+    add("circle", [pi](float t) {
+        return QVector3D(3.0f * std::cos(2.0f * pi * 0.4f * t), 3.0f * std::sin(2.0f * pi * 0.4f * t), 9.0f);
+    });
+    return trajectories;
+}
+
+/**
+ * @brief loadTrajectory : read a recorded head movement, one "x y z" eye position per line, # for comments
+ * @param path
+ * @param trajectory
+ * @return false if the file can't be read or has no positions
+ */
+static bool loadTrajectory(const QString &path, Trajectory &trajectory) {
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+        return false;
+
+    trajectory.name = path;
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+        const QStringList fields = line.split(' ', QString::SkipEmptyParts);
+        if (fields.size() >= 3)
+            trajectory.eyes.push_back(QVector3D(fields[0].toFloat(), fields[1].toFloat(), fields[2].toFloat()));
+    }
+    return !trajectory.eyes.empty();
+}
+
+static double percentile(std::vector<double> &ms, double p) {
+    if (ms.empty())
+        return 0.0;
+    std::sort(ms.begin(), ms.end());
+    return ms[std::min(ms.size() - 1, size_t(p * ms.size()))];
+}
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+    app.setApplicationName("renderbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders the scene offscreen along scripted head trajectories and reports the cost per frame.");
+    parser.addHelpOption();
+    QCommandLineOption framesOption("frames", "Frames per trajectory.", "count", "600");
+    QCommandLineOption sizeOption("size", "Framebuffer size.", "WxH", "1080x2240");
+    QCommandLineOption trajectoryOption("trajectory", "Replay a recorded trajectory instead: \"x y z\" per line.", "file");
+    QCommandLineOption stereoOption("stereo", "Render side by side for two eyes this far apart, in scene units.", "separation");
+    QCommandLineOption glVersionOption("gl-version", "Ask for this OpenGL version, stereo is single pass from 3.3 (GLES 3.0 with GL_EXT_clip_cull_distance).", "major.minor");
+    parser.addOptions({framesOption, sizeOption, trajectoryOption, stereoOption, glVersionOption});
+    parser.process(app);
+
+    const QStringList size = parser.value(sizeOption).split('x');
+    const int width = size.value(0).toInt(), height = size.value(1).toInt();
+    if (width <= 0 || height <= 0) {
+        qDebug() << "bad --size" << parser.value(sizeOption);
+        return 1;
+    }
+
+    std::vector<Trajectory> trajectories;
+    if (parser.isSet(trajectoryOption)) {
+        Trajectory recorded;
+        if (!loadTrajectory(parser.value(trajectoryOption), recorded)) {
+            qDebug() << "Can't read" << parser.value(trajectoryOption);
+            return 1;
+        }
+        trajectories.push_back(recorded);
+    } else {
+        trajectories = scripted(qMax(1, parser.value(framesOption).toInt()));
+    }
+
+    const bool stereo = parser.isSet(stereoOption);
+    const QVector3D eyeOffset(parser.value(stereoOption).toFloat() / 2.0f, 0.0f, 0.0f);
+
+    QSurfaceFormat format;
+    format.setDepthBufferSize(24);
+    if (parser.isSet(glVersionOption)) {
+        const QStringList version = parser.value(glVersionOption).split('.');
+        format.setVersion(version.value(0).toInt(), version.value(1).toInt());
+        format.setProfile(QSurfaceFormat::CompatibilityProfile);
+    }
+    QOffscreenSurface surface;
+    surface.setFormat(format);
+    surface.create();
+
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!context.create() || !context.makeCurrent(&surface)) {
+        qDebug() << "no OpenGL context";
+        return 1;
+    }
+    QOpenGLFunctions *gl = context.functions();
+    qDebug() << "renderer:" << reinterpret_cast<const char *>(gl->glGetString(GL_RENDERER))
+             << reinterpret_cast<const char *>(gl->glGetString(GL_VERSION));
+
+    QOpenGLFramebufferObject fbo(width, height, QOpenGLFramebufferObject::CombinedDepthStencil);
+    fbo.bind();
+    gl->glViewport(0, 0, width, height);
+
+    int status = 0;
+    {
+        PerspectiveRenderer renderer;
+        qint64 initStart = monotonicNs();
+        if (!renderer.initialize()) {
+            qDebug() << "Can't build the shaders";
+            return 1;
+        }
+        qint64 initialized = monotonicNs();
+        renderer.waitForTextures();
+        qDebug().nospace() << "initialize " << (initialized - initStart) / 1e6 << " ms, textures "
+                           << (renderer.texturesLoaded() ? "uploaded " : "MISSING ") << (monotonicNs() - initStart) / 1e6
+                           << " ms after the start, " << renderer.getCounters().uploadedBytes << " bytes";
+        const ShaderCache::Report &shaders = renderer.getShaderReport();
+        qDebug().nospace() << "shaders: " << (!shaders.binarySupported ? "no program binaries" : shaders.cacheHit ? "cache hit" : "cache miss")
+                           << ", load " << shaders.loadMs << " ms, compile " << shaders.compileMs << " ms, store "
+                           << shaders.storeMs << " ms";
+        if (stereo)
+            qDebug() << "stereo:" << (renderer.initializeStereo() ? "single pass, instanced"
+                                             : renderer.isInstanced() ? "instanced, one pass per eye" : "one draw per eye");
+        renderer.resetCounters();
+        renderer.resize(width, height);
+
+        //mono, or a side by side frame for the eyes on each side of the trajectory position
+        auto draw = [&](const QVector3D &eye) {
+            if (stereo)
+                renderer.renderStereo(eye - eyeOffset, eye + eyeOffset, eye.z() * 3.5f);
+            else
+                draw(eye);
+        };
+
+        for (const Trajectory &trajectory : trajectories) {
+            //warm up: first frames pay for shader and texture residency
+            draw(trajectory.eyes.front());
+            gl->glFinish();
+            renderer.resetCounters();
+
+            std::vector<double> cpuMs, frameMs;
+            for (const QVector3D &eye : trajectory.eyes) {
+                qint64 start = monotonicNs();
+                draw(eye);
+                qint64 submitted = monotonicNs();
+                gl->glFinish(); //also wait for the rasterization, so llvmpipe runs are comparable
+                qint64 finished = monotonicNs();
+                cpuMs.push_back((submitted - start) / 1e6);
+                frameMs.push_back((finished - start) / 1e6);
+            }
+
+            const RenderCounters &counters = renderer.getCounters();
+            const double frames = double(counters.frames);
+            qDebug().nospace() << trajectory.name << ": " << counters.frames << " frames, cpu p50 "
+                               << percentile(cpuMs, 0.50) << " ms, p95 " << percentile(cpuMs, 0.95)
+                               << " ms, p99 " << percentile(cpuMs, 0.99) << " ms; with glFinish p50 "
+                               << percentile(frameMs, 0.50) << " ms, p95 " << percentile(frameMs, 0.95) << " ms";
+            qDebug().nospace() << "    per frame: " << counters.glCalls / frames << " GL calls, "
+                               << counters.drawCalls / frames << " draws, " << counters.stateChanges / frames
+                               << " state changes, " << counters.uniformUploads / frames << " uniform uploads, "
+                               << counters.bufferUploads / frames << " buffer uploads ("
+                               << counters.uploadedBytes / frames << " bytes)";
+        }
+
+        if (gl->glGetError() != GL_NO_ERROR) {
+            qDebug() << "OpenGL error during the run";
+            status = 1;
+        }
+        renderer.destroy();
+    }
+
+    fbo.release();
+    context.doneCurrent();
+    return status;
+}
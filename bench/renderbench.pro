@@ -0,0 +1,37 @@
+# Offscreen benchmark of the scene rendering: scripted head trajectories drawn into an FBO, no window or camera.
+# Runs on a machine without a GPU through Mesa llvmpipe: QT_QPA_PLATFORM=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./renderbench
+# Side by side stereo against mono: ./renderbench --stereo 1.5 --gl-version 3.3
+QT += gui
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = renderbench
+
+INCLUDEPATH += ..
+
+SOURCES += \
+        renderbench.cpp \
+        ../frustumculler.cpp \
+        ../ktxfile.cpp \
+        ../meshfile.cpp \
+        ../offaxisprojection.cpp \
+        ../perspectiverenderer.cpp \
+        ../scene.cpp \
+        ../shadercache.cpp \
+        ../textureloader.cpp
+
+HEADERS += \
+    ../frustumculler.h \
+    ../ktxfile.h \
+    ../meshfile.h \
+    ../monotonicclock.h \
+    ../offaxisprojection.h \
+    ../perspectiverenderer.h \
+    ../scene.h \
+    ../shadercache.h \
+    ../textureloader.h
+
+RESOURCES += \
+    ../scene.qrc \
+    ../shaders.qrc \
+    ../textures.qrc
@@ -0,0 +1,343 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QPointF>
+#include <QRegExp>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "detectionworker.h"
+#include "fileframesource.h"
+#include "hotpathtrace.h"
+
+/**
+ * @brief The StageSamples struct : every duration of one stage during the replay, the StageStats only keep aggregates
+ */
+struct StageSamples
+{
+    StageSamples(const char *name, const StageStats *stats) : name(name), stats(stats) {}
+
+    const char *name;
+    const StageStats *stats;
+    quint64 seen = 0;
+    std::vector<double> ms;
+
+    //called after every frame: the stage ran if its counter moved
+    void collect() {
+        if (stats->count() != seen) {
+            seen = stats->count();
+            ms.push_back(stats->lastMs());
+        }
+    }
+
+    double percentile(double p) {
+        if (ms.empty())
+            return 0.0;
+        std::sort(ms.begin(), ms.end());
+        return ms[std::min(ms.size() - 1, size_t(p * ms.size()))];
+    }
+};
+
+/**
+ * @brief loadGroundTruth : read the annotations, one line per frame: "frame leftX leftY rightX rightY", eye centers
+ * in pixels of the upright detection image, frames numbered from 1. Lines starting with # are ignored.
+ * @param path
+ * @param truth : receives the midpoint between the eyes of every annotated frame
+ * @return false if the file can't be read
+ */
+static bool loadGroundTruth(const QString &path, QHash<quint64, QPointF> &truth) {
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+        return false;
+
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+        const QStringList fields = line.split(QRegExp("[\\s,]+"));
+        if (fields.size() < 5)
+            continue;
+        QPointF left(fields[1].toDouble(), fields[2].toDouble());
+        QPointF right(fields[3].toDouble(), fields[4].toDouble());
+        truth.insert(fields[0].toULongLong(), (left + right) / 2.0);
+    }
+    return true;
+}
+
+static QPointF eyesMidpoint(const HeadPose &pose) {
+    return (pose.leftEye.center() + pose.rightEye.center()) / 2.0;
+}
+
+static double length(const QPointF &p) {
+    return std::sqrt(p.x() * p.x() + p.y() * p.y());
+}
+
+/**
+ * @brief The ReplayResult struct : the numbers the detectors are compared on
+ */
+struct ReplayResult
+{
+    double fps = 0.0;
+    double hitRate = 0.0;
+    double detectP95Ms = 0.0;
+    double fullSearchP95Ms = 0.0;   // re-acquisition, the worst case
+    double rmsError = -1.0; // negative without ground truth
+};
+
+/**
+ * @brief replay : run every frame of a recording through one detection pipeline and print its report
+ * @param input : video file or image sequence
+ * @param orientation : anti-clockwise rotation of the recorded frames
+ * @param detectionSize : upright size the detection runs at
+ * @param settings : tracking settings, including the detector backend
+ * @param truth : eye annotations, can be empty
+ * @param result : receives the summary
+ * @return false if the recording or the detector could not be opened
+ */
+static bool replay(const QString &input, int orientation, const QSize &detectionSize, const TrackingSettings &settings,
+                   const QHash<quint64, QPointF> &truth, ReplayResult &result) {
+    FileFrameSource source(input, 30.0, orientation);
+    if (!source.isOpen())
+        return false;
+
+    TripleBuffer<HeadPose> poses;
+    DetectionWorker worker(detectionSize, poses);
+    worker.setTrackingSettings(settings);
+    if (worker.getDetector() != settings.detector)
+        return false;
+    qDebug().nospace() << "== " << FaceDetectorBackend::kindName(worker.getDetector()) << " detector, "
+                       << settings.detectionThreads << " threads (0: one per core), loaded "
+                       << (worker.detectorLoadedFromCache() ? "from the cache" : "from the models") << " in "
+                       << worker.getDetectorLoadMs() << " ms";
+
+    std::vector<StageSamples> stages = {
+        {"decode", &source.getCaptureStats()},
+        {"convert", &worker.getConvertStats()},
+        {"motion gate", &worker.getMotionGateStats()},
+        {"detect", &worker.getDetectStats()},
+        {"face search (tracked)", &worker.getRoiSearchStats()},
+        {"face search (full frame)", &worker.getFullSearchStats()},
+        {"eyes (detector)", &worker.getEyeCascadeStats()},
+        {"eyes (optical flow)", &worker.getEyeFlowStats()},
+        {"distance", &worker.getDistanceStats()},
+        {"pose publish", &worker.getPublishStats()},
+    };
+
+    quint64 frames = 0, faceHits = 0, eyeHits = 0;
+    qint64 pipelineNs = 0;
+
+    //jitter: frame to frame movement of the detected eyes, and of the error against the annotations
+    bool havePrevious = false, havePreviousError = false;
+    QPointF previous, previousError;
+    double motionSquares = 0.0, errorSum = 0.0, errorSquares = 0.0, errorJitterSquares = 0.0;
+    quint64 motionSamples = 0, errorSamples = 0, errorJitterSamples = 0, annotatedFrames = 0;
+
+    LumaFrame frame;
+    QElapsedTimer wall;
+    wall.start();
+    while (source.readFrame(frame)) {
+        qint64 start = monotonicNs();
+        worker.processFrame(frame);
+        pipelineNs += monotonicNs() - start;
+
+        const HeadPose pose = poses.read();
+        frames++;
+        for (StageSamples &stage : stages)
+            stage.collect();
+
+        if (pose.hasFace())
+            faceHits++;
+        if (!pose.hasEyes()) {
+            havePrevious = havePreviousError = false;
+            annotatedFrames += truth.contains(frame.sequence);
+            continue;
+        }
+        eyeHits++;
+
+        QPointF eyes = eyesMidpoint(pose);
+        if (havePrevious) {
+            double motion = length(eyes - previous);
+            motionSquares += motion * motion;
+            motionSamples++;
+        }
+        previous = eyes;
+        havePrevious = true;
+
+        auto annotation = truth.constFind(frame.sequence);
+        if (annotation == truth.constEnd()) {
+            havePreviousError = false;
+            continue;
+        }
+        annotatedFrames++;
+        QPointF error = eyes - *annotation;
+        errorSum += length(error);
+        errorSquares += length(error) * length(error);
+        errorSamples++;
+        if (havePreviousError) {
+            double change = length(error - previousError);
+            errorJitterSquares += change * change;
+            errorJitterSamples++;
+        }
+        previousError = error;
+        havePreviousError = true;
+    }
+    const double wallSeconds = wall.nsecsElapsed() / 1e9;
+
+    if (!frames) {
+        qDebug() << "no frames in" << input;
+        return false;
+    }
+
+    result.fps = pipelineNs > 0 ? frames * 1e9 / pipelineNs : 0.0;
+    result.hitRate = double(eyeHits) / frames;
+    result.detectP95Ms = stages[3].percentile(0.95);
+    result.fullSearchP95Ms = stages[5].percentile(0.95);
+
+    qDebug().nospace() << frames << " frames in " << wallSeconds << " s: " << frames / wallSeconds
+                       << " fps with decoding, " << result.fps << " fps detection only";
+    for (StageSamples &stage : stages) {
+        if (stage.ms.empty())
+            continue;
+        qDebug().nospace() << stage.name << ": " << stage.ms.size() << " samples, p50 " << stage.percentile(0.50)
+                           << " ms, p95 " << stage.percentile(0.95) << " ms, p99 " << stage.percentile(0.99)
+                           << " ms, max " << stage.stats->maxMs() << " ms";
+    }
+    qDebug().nospace() << "face found in " << 100.0 * faceHits / frames << "% of the frames, both eyes in "
+                       << 100.0 * result.hitRate << "%";
+    if (settings.motionGating)
+        qDebug().nospace() << "motion gate: " << worker.getGatedCount() << " of " << frames << " frames reused the last pose";
+    if (settings.adaptiveDetection) {
+        const DetectionGovernor &governor = worker.getGovernor();
+        qDebug().nospace() << "governor: ended at resolution " << governor.currentResolution() << ", scale step "
+                           << governor.currentScaleStep() << ", " << governor.currentRate() << " detections/s, "
+                           << worker.getRateSkippedCount() << " frames skipped";
+    }
+    if (motionSamples)
+        qDebug().nospace() << "eye position jitter (rms frame to frame): " << std::sqrt(motionSquares / motionSamples) << " px";
+
+    if (!truth.isEmpty()) {
+        qDebug().nospace() << "ground truth: " << annotatedFrames << " annotated frames, eyes found in " << errorSamples;
+        if (errorSamples) {
+            result.rmsError = std::sqrt(errorSquares / errorSamples);
+            qDebug().nospace() << "error: mean " << errorSum / errorSamples << " px, rms " << result.rmsError << " px";
+        }
+        if (errorJitterSamples)
+            qDebug().nospace() << "error jitter (rms frame to frame): "
+                               << std::sqrt(errorJitterSquares / errorJitterSamples) << " px";
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("replaybench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a recording through the face and eye detection and reports its speed and accuracy.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", "Video file or image sequence pattern, e.g. frames/%04d.png");
+    QCommandLineOption orientationOption("orientation", "Anti-clockwise rotation of the recorded frames.", "degrees", "0");
+    QCommandLineOption sizeOption("size", "Upright size the detection runs at.", "WxH", "240x320");
+    QCommandLineOption truthOption("ground-truth", "Eye annotations: \"frame leftX leftY rightX rightY\" per line.", "file");
+    QCommandLineOption detectorOption("detector", "Detector backends to compare, comma separated: haar, lbp, dnn.", "list", "haar");
+    QCommandLineOption lbpModelOption("lbp-model", "LBP face cascade, e.g. lbpcascade_frontalface_improved.xml.", "file");
+    QCommandLineOption dnnModelOption("dnn-model", "YuNet face model, e.g. face_detection_yunet_2023mar.onnx.", "file");
+    QCommandLineOption threadsOption("threads", "Threads per search to compare, comma separated, 0 for one per core.", "list", "0");
+    QCommandLineOption noRoiOption("no-roi", "Search the whole frame for the face every frame.");
+    QCommandLineOption noFlowOption("no-flow", "Run the eye detector every frame instead of following the eyes.");
+    QCommandLineOption eyeCascadeOption("eye-cascade", "Find the eyes with the detector instead of the pupil gradients.");
+    QCommandLineOption equalizeOption("equalize", "Equalize the histogram of every frame.");
+    QCommandLineOption noGateOption("no-gate", "Detect every frame, even when nothing moved.");
+    QCommandLineOption budgetOption("budget", "Adapt resolution, scale step and rate to hold this detection time.", "ms");
+    QCommandLineOption traceOption("trace", "Write a Chrome trace of the replay.", "file");
+    QCommandLineOption minFpsOption("min-fps", "Exit with an error below this detection rate.", "fps", "0");
+    QCommandLineOption minHitRateOption("min-hit-rate", "Exit with an error below this fraction of frames with both eyes.", "rate", "0");
+    parser.addOptions({orientationOption, sizeOption, truthOption, detectorOption, lbpModelOption, dnnModelOption, threadsOption,
+                       noRoiOption, noFlowOption, eyeCascadeOption, equalizeOption, noGateOption, budgetOption, traceOption, minFpsOption, minHitRateOption});
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    const QStringList size = parser.value(sizeOption).split('x');
+    if (size.size() != 2 || size[0].toInt() <= 0 || size[1].toInt() <= 0) {
+        qDebug() << "bad --size" << parser.value(sizeOption);
+        return 1;
+    }
+
+    QHash<quint64, QPointF> truth;
+    if (parser.isSet(truthOption) && !loadGroundTruth(parser.value(truthOption), truth)) {
+        qDebug() << "Can't read" << parser.value(truthOption);
+        return 1;
+    }
+
+    TrackingSettings settings;
+    settings.roiTracking = !parser.isSet(noRoiOption);
+    settings.eyeFlowTracking = !parser.isSet(noFlowOption);
+    settings.pupilLocalization = !parser.isSet(eyeCascadeOption);
+    settings.equalizeHistogram = parser.isSet(equalizeOption);
+    settings.motionGating = !parser.isSet(noGateOption);
+    if (parser.isSet(budgetOption)) {
+        settings.adaptiveDetection = true;
+        settings.latencyBudgetMs = parser.value(budgetOption).toFloat();
+    }
+
+    const QStringList threadCounts = parser.value(threadsOption).split(',', QString::SkipEmptyParts);
+
+    int status = 0;
+    std::vector<std::pair<QString, ReplayResult>> results;
+    for (const QString &name : parser.value(detectorOption).split(',', QString::SkipEmptyParts)) {
+        if (!FaceDetectorBackend::parseKind(name.trimmed(), settings.detector)) {
+            qDebug() << "unknown detector" << name;
+            return 1;
+        }
+        settings.detectorModel = settings.detector == FaceDetectorBackend::Lbp ? parser.value(lbpModelOption)
+                               : settings.detector == FaceDetectorBackend::Dnn ? parser.value(dnnModelOption) : QString();
+
+        for (const QString &threads : threadCounts) {
+            settings.detectionThreads = threads.toInt();
+
+            ReplayResult result;
+            if (!replay(parser.positionalArguments().first(), parser.value(orientationOption).toInt(),
+                        QSize(size[0].toInt(), size[1].toInt()), settings, truth, result)) {
+                qDebug() << "can't replay with the" << FaceDetectorBackend::kindName(settings.detector) << "detector";
+                status = 1;
+                continue;
+            }
+            results.push_back(std::make_pair(QString("%1, %2 threads").arg(FaceDetectorBackend::kindName(settings.detector))
+                                             .arg(settings.detectionThreads), result));
+
+            if (result.fps < parser.value(minFpsOption).toDouble()) {
+                qDebug() << "detection rate below --min-fps";
+                status = 1;
+            }
+            if (result.hitRate < parser.value(minHitRateOption).toDouble()) {
+                qDebug() << "hit rate below --min-hit-rate";
+                status = 1;
+            }
+        }
+    }
+
+    if (results.size() > 1) {
+        qDebug() << "== summary";
+        for (const auto &entry : results) {
+            QDebug line = qDebug().nospace().noquote();
+            line << entry.first << ": " << entry.second.fps << " fps, detect p95 " << entry.second.detectP95Ms
+                 << " ms, full frame search p95 " << entry.second.fullSearchP95Ms << " ms, eyes in "
+                 << 100.0 * entry.second.hitRate << "% of the frames";
+            if (entry.second.rmsError >= 0.0)
+                line << ", rms error " << entry.second.rmsError << " px";
+        }
+    }
+
+    if (parser.isSet(traceOption) && !HotPathTrace::writeChromeTrace(parser.value(traceOption)))
+        qDebug() << "could not write trace to" << parser.value(traceOption);
+
+    return status;
+}
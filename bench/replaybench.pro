@@ -0,0 +1,57 @@
+# Offline replay of a recording through the detection pipeline: no QML, camera or window.
+# Built with the app on desktop (make replaybench), or on its own with qmake bench/replaybench.pro
+QT -= gui
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = replaybench
+
+INCLUDEPATH += ..
+
+SOURCES += \
+        replaybench.cpp \
+        ../cascadebackend.cpp \
+        ../cascadecache.cpp \
+        ../detectiongovernor.cpp \
+        ../detectionworker.cpp \
+        ../dnnfacebackend.cpp \
+        ../eyeflowtracker.cpp \
+        ../facedetectorbackend.cpp \
+        ../fileframesource.cpp \
+        ../framepreprocessor.cpp \
+        ../framequeue.cpp \
+        ../hotpathtrace.cpp \
+        ../lumakernels.cpp \
+        ../motiongate.cpp \
+        ../pupilkernels.cpp \
+        ../pupillocator.cpp
+
+HEADERS += \
+    ../cascadebackend.h \
+    ../cascadecache.h \
+    ../detectiongovernor.h \
+    ../detectionworker.h \
+    ../dnnfacebackend.h \
+    ../eyeflowtracker.h \
+    ../facedetectorbackend.h \
+    ../fileframesource.h \
+    ../framepreprocessor.h \
+    ../framequeue.h \
+    ../framesource.h \
+    ../headpose.h \
+    ../hotpathtrace.h \
+    ../lumaframe.h \
+    ../lumakernels.h \
+    ../monotonicclock.h \
+    ../motiongate.h \
+    ../pupilkernels.h \
+    ../pupillocator.h \
+    ../stagestats.h \
+    ../triplebuffer.h
+
+RESOURCES += ../cascades.qrc
+
+unix:!android {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += opencv4
+}
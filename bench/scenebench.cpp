@@ -0,0 +1,172 @@
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QVector3D>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "monotonicclock.h"
+#include "perspectiverenderer.h"
+
+static double percentile(std::vector<double> &ms, double p) {
+    if (ms.empty())
+        return 0.0;
+    std::sort(ms.begin(), ms.end());
+    return ms[std::min(ms.size() - 1, size_t(p * ms.size()))];
+}
+
+/**
+ * @brief addObjects : scatter small cubes until the scene has that many of them, in a volume twice as wide and high as
+ * the screen and 10 units deep behind it, so an off-axis view sees part of them
+ * @param scene
+ * @param mesh : the cube mesh
+ * @param count : cubes wanted
+ * @param halfHeight : half the screen height in scene units
+ * @param random
+ */
+static void addObjects(Scene &scene, int mesh, int count, float halfHeight, std::mt19937 &random) {
+    std::uniform_real_distribution<float> x(-6.0f, 6.0f), y(-2.0f * halfHeight, 2.0f * halfHeight), z(-10.0f, 0.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 360.0f), size(0.05f, 0.2f);
+    while (scene.getBatches()[mesh].instanceCount() < count) {
+        QMatrix4x4 transform;
+        transform.translate(x(random), y(random), z(random));
+        transform.rotate(angle(random), QVector3D(1.0f, 0.0f, 0.0f));
+        transform.rotate(angle(random), QVector3D(0.0f, 1.0f, 0.0f));
+        transform.scale(size(random));
+        scene.addObject(mesh, transform);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+    app.setApplicationName("scenebench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders the scene offscreen with more and more objects and reports the cost per frame.");
+    parser.addHelpOption();
+    QCommandLineOption framesOption("frames", "Frames per object count.", "count", "300");
+    QCommandLineOption sizeOption("size", "Framebuffer size.", "WxH", "1080x2240");
+    QCommandLineOption countsOption("counts", "Object counts to sweep, comma separated.", "list", "1,10,100,1000,5000,10000,20000");
+    QCommandLineOption noInstancingOption("no-instancing", "Draw every object on its own.");
+    QCommandLineOption noCullingOption("no-culling", "Draw every object, visible or not.");
+    QCommandLineOption stereoOption("stereo", "Render side by side for two eyes this far apart, in scene units.", "separation");
+    QCommandLineOption glVersionOption("gl-version", "Ask for this OpenGL version, instancing needs 3.3 (GLES 3.0).", "major.minor", "3.3");
+    parser.addOptions({framesOption, sizeOption, countsOption, noInstancingOption, noCullingOption, stereoOption, glVersionOption});
+    parser.process(app);
+
+    const QStringList size = parser.value(sizeOption).split('x');
+    const int width = size.value(0).toInt(), height = size.value(1).toInt();
+    if (width <= 0 || height <= 0) {
+        qDebug() << "bad --size" << parser.value(sizeOption);
+        return 1;
+    }
+    std::vector<int> counts;
+    for (const QString &count : parser.value(countsOption).split(','))
+        counts.push_back(qMax(0, count.toInt()));
+    std::sort(counts.begin(), counts.end());
+    const int frames = qMax(1, parser.value(framesOption).toInt());
+    const bool stereo = parser.isSet(stereoOption);
+    const QVector3D eyeOffset(parser.value(stereoOption).toFloat() / 2.0f, 0.0f, 0.0f);
+
+    QSurfaceFormat format;
+    format.setDepthBufferSize(24);
+    const QStringList version = parser.value(glVersionOption).split('.');
+    format.setVersion(version.value(0).toInt(), version.value(1).toInt());
+    format.setProfile(QSurfaceFormat::CompatibilityProfile);
+    QOffscreenSurface surface;
+    surface.setFormat(format);
+    surface.create();
+
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!context.create() || !context.makeCurrent(&surface)) {
+        qDebug() << "no OpenGL context";
+        return 1;
+    }
+    QOpenGLFunctions *gl = context.functions();
+    qDebug() << "renderer:" << reinterpret_cast<const char *>(gl->glGetString(GL_RENDERER))
+             << reinterpret_cast<const char *>(gl->glGetString(GL_VERSION));
+
+    QOpenGLFramebufferObject fbo(width, height, QOpenGLFramebufferObject::CombinedDepthStencil);
+    fbo.bind();
+    gl->glViewport(0, 0, width, height);
+
+    int status = 0;
+    {
+        PerspectiveRenderer renderer;
+        renderer.setInstancing(!parser.isSet(noInstancingOption));
+        renderer.resize(width, height);
+        if (!renderer.loadScene(":/scene.json") || !renderer.initialize()) {
+            qDebug() << "Can't set up the renderer";
+            return 1;
+        }
+        renderer.waitForTextures();
+        Scene &scene = renderer.getScene();
+        scene.setCulling(!parser.isSet(noCullingOption));
+        const int cube = scene.findMesh("cube");
+        const bool single = stereo && renderer.initializeStereo();
+        qDebug().nospace() << (renderer.isInstanced() ? "instanced" : "one draw per object")
+                           << (stereo ? (single ? ", side by side stereo" : ", side by side stereo, one pass per eye") : "")
+                           << (parser.isSet(noCullingOption) ? ", no culling" : "");
+
+        //the head sways in front of the screen, half a period per second
+        const float pi = 3.14159265f;
+        std::vector<QVector3D> eyes;
+        for (int i = 0; i < frames; i++)
+            eyes.push_back(QVector3D(4.0f * std::sin(pi * i / 60.0f), 1.0f, 10.0f));
+
+        std::mt19937 random(1);
+        for (int count : counts) {
+            addObjects(scene, cube, count, 3.0f * height / width, random);
+
+            auto draw = [&](const QVector3D &eye) {
+                if (stereo)
+                    renderer.renderStereo(eye - eyeOffset, eye + eyeOffset, eye.z() * 3.5f);
+                else
+                    renderer.render(eye, eye.z() * 3.5f);
+            };
+
+            //warm up: the instance buffer grows to this count
+            draw(eyes.front());
+            gl->glFinish();
+            renderer.resetCounters();
+
+            std::vector<double> cpuMs, frameMs;
+            for (const QVector3D &eye : eyes) {
+                qint64 start = monotonicNs();
+                draw(eye);
+                qint64 submitted = monotonicNs();
+                gl->glFinish();
+                qint64 finished = monotonicNs();
+                cpuMs.push_back((submitted - start) / 1e6);
+                frameMs.push_back((finished - start) / 1e6);
+            }
+
+            const RenderCounters &counters = renderer.getCounters();
+            const double n = double(counters.frames);
+            qDebug().nospace() << count << " objects: cpu p50 " << percentile(cpuMs, 0.50) << " ms, p95 "
+                               << percentile(cpuMs, 0.95) << " ms; with glFinish p50 " << percentile(frameMs, 0.50)
+                               << " ms, p95 " << percentile(frameMs, 0.95) << " ms";
+            qDebug().nospace() << "    per frame: " << counters.visibleObjects / n << " visible of "
+                               << counters.objects / n << ", culling " << counters.cullNs / n / 1e3 << " us, "
+                               << counters.drawCalls / n << " draws, " << counters.glCalls / n << " GL calls, "
+                               << counters.uploadedBytes / n << " bytes uploaded";
+        }
+
+        if (gl->glGetError() != GL_NO_ERROR) {
+            qDebug() << "OpenGL error during the run";
+            status = 1;
+        }
+        renderer.destroy();
+    }
+
+    fbo.release();
+    context.doneCurrent();
+    return status;
+}
@@ -0,0 +1,37 @@
+# Object count sweep of the scene rendering: more and more cubes drawn offscreen into an FBO along a head sway.
+# Runs on a machine without a GPU through Mesa llvmpipe: QT_QPA_PLATFORM=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./scenebench
+# Against one draw per object: ./scenebench --no-instancing, without the frustum culling: ./scenebench --no-culling
+QT += gui
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = scenebench
+
+INCLUDEPATH += ..
+
+SOURCES += \
+        scenebench.cpp \
+        ../frustumculler.cpp \
+        ../ktxfile.cpp \
+        ../meshfile.cpp \
+        ../offaxisprojection.cpp \
+        ../perspectiverenderer.cpp \
+        ../scene.cpp \
+        ../shadercache.cpp \
+        ../textureloader.cpp
+
+HEADERS += \
+    ../frustumculler.h \
+    ../ktxfile.h \
+    ../meshfile.h \
+    ../monotonicclock.h \
+    ../offaxisprojection.h \
+    ../perspectiverenderer.h \
+    ../scene.h \
+    ../shadercache.h \
+    ../textureloader.h
+
+RESOURCES += \
+    ../scene.qrc \
+    ../shaders.qrc \
+    ../textures.qrc
@@ -0,0 +1,262 @@
+#include "cameraframesource.h"
+#include "headpose.h"
+#include <QMediaObject>
+#include <QMutex>
+#include <QDebug>
+#include <opencv2/imgproc.hpp>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+/**
+ * @brief The FrameSlot struct : a frame holder, with room for the control block of the shared_ptr that leases it
+ */
+struct FrameSlot
+{
+    QVideoFrame frame;
+    cv::Mat converted; // luminance of the packed YUV frames, reused from one lease to the next
+    alignas(std::max_align_t) unsigned char lease[128];
+};
+
+/**
+ * @brief The FrameSlotPool class : the frame holders of a CameraFrameSource. A frame passed on holds a lease on its
+ * slot, the last copy of the lease hands the slot back under the mutex, so whatever the detector read from the
+ * buffer happens before the camera thread unmaps it. It lives as long as the leases do.
+ */
+class FrameSlotPool : public std::enable_shared_from_this<FrameSlotPool>
+{
+public:
+    explicit FrameSlotPool(int size);
+    ~FrameSlotPool();
+
+    std::shared_ptr<FrameSlot> acquire();
+    void releaseFree();
+    void giveBack(FrameSlot *slot);
+
+private:
+    QMutex mutex;
+    std::vector<std::unique_ptr<FrameSlot>> slots; // only touched by the capture thread
+    std::vector<FrameSlot *> freeSlots;            // guarded by the mutex
+};
+
+/**
+ * @brief The LeaseAllocator struct : puts the control block of a lease in its slot instead of on the heap, and
+ * hands the slot back when the block is freed, the last thing done with the lease
+ */
+template <typename T>
+struct LeaseAllocator
+{
+    using value_type = T;
+
+    LeaseAllocator(const std::shared_ptr<FrameSlotPool> &pool, FrameSlot *slot) : pool(pool), slot(slot) {}
+    template <typename U>
+    LeaseAllocator(const LeaseAllocator<U> &other) : pool(other.pool), slot(other.slot) {}
+
+    T *allocate(std::size_t n) {
+        if (n * sizeof(T) <= sizeof(slot->lease) && alignof(T) <= alignof(std::max_align_t))
+            return reinterpret_cast<T *>(slot->lease);
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, std::size_t) {
+        if (static_cast<void *>(p) != slot->lease)
+            ::operator delete(p);
+        pool->giveBack(slot);
+    }
+
+    std::shared_ptr<FrameSlotPool> pool;
+    FrameSlot *slot;
+};
+
+template <typename T, typename U>
+bool operator==(const LeaseAllocator<T> &a, const LeaseAllocator<U> &b) {
+    return a.slot == b.slot;
+}
+
+template <typename T, typename U>
+bool operator!=(const LeaseAllocator<T> &a, const LeaseAllocator<U> &b) {
+    return a.slot != b.slot;
+}
+
+/**
+ * @brief FrameSlotPool::FrameSlotPool : constructor
+ * @param size : slots allocated up front
+ */
+FrameSlotPool::FrameSlotPool(int size) {
+    for (int i = 0; i < size; i++) {
+        slots.push_back(std::unique_ptr<FrameSlot>(new FrameSlot));
+        freeSlots.push_back(slots.back().get());
+    }
+}
+
+/**
+ * @brief FrameSlotPool::~FrameSlotPool : destructor, no lease is left, unmap everything
+ */
+FrameSlotPool::~FrameSlotPool() {
+    for (const std::unique_ptr<FrameSlot> &slot : slots) {
+        if (slot->frame.isMapped())
+            slot->frame.unmap();
+    }
+}
+
+/**
+ * @brief FrameSlotPool::acquire : lease a slot that nobody downstream uses anymore.
+ * Reusing the slots and their control blocks keeps the capture path free of allocations once the pool is warm.
+ * @return a slot with an unmapped, empty frame, handed back when the last copy is dropped
+ */
+std::shared_ptr<FrameSlot> FrameSlotPool::acquire() {
+    FrameSlot *slot = nullptr;
+    {
+        QMutexLocker locker(&mutex);
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+    }
+
+    if (!slot) {
+        //every slot is still queued or being detected, grow the pool
+        slots.push_back(std::unique_ptr<FrameSlot>(new FrameSlot));
+        slot = slots.back().get();
+        QMutexLocker locker(&mutex);
+        freeSlots.reserve(slots.size()); //giveBack() must not allocate
+    }
+
+    if (slot->frame.isMapped())
+        slot->frame.unmap();
+    slot->frame = QVideoFrame();
+
+    //nothing to delete, the allocator hands the slot back
+    return std::shared_ptr<FrameSlot>(slot, [](FrameSlot *) {}, LeaseAllocator<FrameSlot>(shared_from_this(), slot));
+}
+
+/**
+ * @brief FrameSlotPool::releaseFree : unmap the free slots and let go of their camera buffers
+ */
+void FrameSlotPool::releaseFree() {
+    QMutexLocker locker(&mutex);
+    for (FrameSlot *slot : freeSlots) {
+        if (slot->frame.isMapped())
+            slot->frame.unmap();
+        slot->frame = QVideoFrame();
+        slot->converted.release();
+    }
+}
+
+/**
+ * @brief FrameSlotPool::giveBack : the last copy of a lease is gone, on whatever thread dropped it
+ * @param slot
+ */
+void FrameSlotPool::giveBack(FrameSlot *slot) {
+    QMutexLocker locker(&mutex);
+    freeSlots.push_back(slot);
+}
+
+/**
+ * @brief CameraFrameSource::CameraFrameSource : constructor
+ * @param qmlCamera : the Camera item from QML
+ * @param orientation : anti-clockwise rotation of the camera frames, like VideoOutput.orientation
+ * @param parent
+ */
+CameraFrameSource::CameraFrameSource(QObject *qmlCamera, int orientation, QObject *parent) :
+    FrameSource(parent),
+    qmlCamera(qmlCamera),
+    slots(std::make_shared<FrameSlotPool>(4)), //the frames waiting in the detector queue plus the one being detected
+    orientation(orientation)
+{
+    //Direct connection: frames are wrapped on whatever thread the camera delivers them
+    connect(&probe, &QVideoProbe::videoFrameProbed, this, &CameraFrameSource::videoFrameProbed, Qt::DirectConnection);
+}
+
+/**
+ * @brief CameraFrameSource::start : attach the probe to the QML camera
+ * @return true if the camera accepted the probe
+ */
+bool CameraFrameSource::start() {
+    QMediaObject *camera = qobject_cast<QMediaObject *>(qmlCamera->property("mediaObject").value<QObject *>());
+    if (!camera || !probe.setSource(camera)) {
+        qDebug() << "Can't attach a video probe to the camera.";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief CameraFrameSource::stop : detach the probe
+ */
+void CameraFrameSource::stop() {
+    probe.setSource(static_cast<QMediaObject *>(nullptr));
+    slots->releaseFree();
+}
+
+/**
+ * @brief CameraFrameSource::videoFrameProbed : a new viewfinder frame, pass its luminance on
+ * @param videoFrame
+ */
+void CameraFrameSource::videoFrameProbed(const QVideoFrame &videoFrame) {
+    LumaFrame frame;
+    {
+        ScopedStageTimer timer(captureStats, HotPathTrace::Capture);
+        frame.timestampNs = monotonicNs();
+        if (!wrapFrame(videoFrame, frame))
+            return;
+    }
+    frame.orientation = orientation;
+    frame.sequence = ++frameCount;
+
+    emit frameAvailable(frame);
+}
+
+/**
+ * @brief CameraFrameSource::wrapFrame : map the video frame and get a cv::Mat of its luminance.
+ * YUV frames (NV21 on Android) already start with a full resolution Y plane, which is used in place.
+ * Packed RGB frames are passed on as BGRA, packed YUV frames have to be converted.
+ * @param videoFrame
+ * @param frame : receives the gray Mat and the mapped buffer
+ * @return false if the pixel format is not supported
+ */
+bool CameraFrameSource::wrapFrame(const QVideoFrame &videoFrame, LumaFrame &frame) {
+    //The buffer stays mapped until the detector drops the last copy of the frame and the slot is reused
+    std::shared_ptr<FrameSlot> slot = slots->acquire();
+    QVideoFrame *mapped = &slot->frame;
+    *mapped = videoFrame;
+    if (!mapped->map(QAbstractVideoBuffer::ReadOnly)) {
+        *mapped = QVideoFrame();
+        return false;
+    }
+    void *bits = mapped->bits();
+    int width = mapped->width(), height = mapped->height();
+
+    switch (mapped->pixelFormat()) {
+    case QVideoFrame::Format_NV21:
+    case QVideoFrame::Format_NV12:
+    case QVideoFrame::Format_YUV420P:
+    case QVideoFrame::Format_YV12:
+    case QVideoFrame::Format_Y8:
+        frame.gray = cv::Mat(height, width, CV_8UC1, bits, mapped->bytesPerLine());
+        frame.keepAlive = slot;
+        return true;
+    case QVideoFrame::Format_YUYV:
+    case QVideoFrame::Format_UYVY:
+        //into the Mat of the slot, the lease keeps it from being overwritten while the detector reads it
+        cv::cvtColor(cv::Mat(height, width, CV_8UC2, bits, mapped->bytesPerLine()), slot->converted,
+                     mapped->pixelFormat() == QVideoFrame::Format_YUYV ? cv::COLOR_YUV2GRAY_YUYV : cv::COLOR_YUV2GRAY_UYVY);
+        mapped->unmap();
+        frame.gray = slot->converted;
+        frame.keepAlive = slot;
+        return true;
+    case QVideoFrame::Format_RGB32:
+    case QVideoFrame::Format_ARGB32:
+    case QVideoFrame::Format_ARGB32_Premultiplied:
+        //converted and downscaled in a single pass on the detection thread
+        frame.bgra = cv::Mat(height, width, CV_8UC4, bits, mapped->bytesPerLine());
+        frame.keepAlive = slot;
+        return true;
+    default:
+        if (!unsupportedReported) {
+            qDebug() << "Unsupported camera pixel format" << mapped->pixelFormat();
+            unsupportedReported = true;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef CAMERAFRAMESOURCE_H
+#define CAMERAFRAMESOURCE_H
+
+#include <QVideoProbe>
+#include <QVideoFrame>
+#include <memory>
+#include "framesource.h"
+
+class FrameSlotPool;
+
+class CameraFrameSource : public FrameSource
+{
+    Q_OBJECT
+public:
+    explicit CameraFrameSource(QObject *qmlCamera, int orientation, QObject *parent = nullptr);
+
+    bool start() override;
+    void stop() override;
+
+public slots:
+    // called by the probe on the camera thread, public so frames can be fed without a camera (bench/allocationbench)
+    void videoFrameProbed(const QVideoFrame &frame);
+
+private:
+    bool wrapFrame(const QVideoFrame &videoFrame, LumaFrame &frame);
+
+private:
+    QObject *qmlCamera;
+    QVideoProbe probe;
+    std::shared_ptr<FrameSlotPool> slots; // mapped frames, shared with the leases still downstream
+    int orientation;
+    quint64 frameCount = 0;
+    bool unsupportedReported = false;
+};
+
+#endif // CAMERAFRAMESOURCE_H
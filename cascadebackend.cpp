@@ -0,0 +1,316 @@
+#include "cascadebackend.h"
+#include "cascadecache.h"
+#include <QDebug>
+#include <opencv2/core/utility.hpp>
+#include <algorithm>
+
+static const int minNeighbors = 3;
+static const double groupEps = 0.2; // what detectMultiScale groups its candidates with
+
+/**
+ * @brief biggest : the face kept out of the grouped detections, the largest one, the highest and leftmost on a tie
+ * @param faces : not empty
+ * @return
+ */
+static const cv::Rect &biggest(const std::vector<cv::Rect> &faces) {
+    return *std::max_element(faces.begin(), faces.end(), [](const cv::Rect &a, const cv::Rect &b) {
+        if (a.area() != b.area())
+            return a.area() < b.area();
+        return a.y != b.y ? a.y > b.y : a.x > b.x;
+    });
+}
+
+/**
+ * @brief highest : the detection closest to the top, where the eyes are in a face
+ * @param eyes : not empty
+ * @return
+ */
+static const cv::Rect &highest(const std::vector<cv::Rect> &eyes) {
+    return *std::min_element(eyes.begin(), eyes.end(), [](const cv::Rect &a, const cv::Rect &b) {
+        return a.y != b.y ? a.y < b.y : a.x < b.x;
+    });
+}
+
+/**
+ * @brief CascadeBackend::CascadeBackend : constructor, loads the cascades through the cascade cache
+ * @param kind : Haar or Lbp, for reporting
+ * @param faceCascade : resource or file path of the face cascade
+ * @param eyeCascade : resource or file path of the eye cascade
+ */
+CascadeBackend::CascadeBackend(Kind kind, const QString &faceCascade, const QString &eyeCascade) :
+    backendKind(kind),
+    faceCascade(faceCascade),
+    eyeCascade(eyeCascade)
+{
+    bool cached = false;
+    bool faceLoaded = CascadeCache::load(faceClassifier, faceCascade, &cached);
+    fromCache = cached;
+    if (faceLoaded)
+        qDebug() << "Successfully loaded Face classifier!" << faceCascade;
+    else
+        qDebug() << "Could not load Face classifier." << faceCascade;
+
+    bool eyesLoaded = CascadeCache::load(eyeClassifier, eyeCascade, &cached);
+    fromCache = fromCache && cached;
+    if (eyesLoaded)
+        qDebug() << "Successfully loaded Eye classifier!" << eyeCascade;
+    else
+        qDebug() << "Could not load Eye classifier." << eyeCascade;
+
+    ready = faceLoaded && eyesLoaded;
+}
+
+/**
+ * @brief CascadeBackend::kind
+ * @return Haar or Lbp
+ */
+FaceDetectorBackend::Kind CascadeBackend::kind() const {
+    return backendKind;
+}
+
+/**
+ * @brief CascadeBackend::isReady
+ * @return true if both cascades were loaded
+ */
+bool CascadeBackend::isReady() const {
+    return ready;
+}
+
+/**
+ * @brief CascadeBackend::loadedFromCache
+ * @return true if both cascades came from the cascade cache
+ */
+bool CascadeBackend::loadedFromCache() const {
+    return fromCache;
+}
+
+/**
+ * @brief CascadeBackend::setScaleStep : scale factor of the face cascade pyramid, larger is faster but skips more sizes
+ * @param step : above 1
+ */
+void CascadeBackend::setScaleStep(double step) {
+    scaleStep = std::max(1.01, step);
+}
+
+/**
+ * @brief CascadeBackend::setThreadCount : split the face search by pyramid levels and search both eyes at once.
+ * The copies of the cascades the threads need are loaded by the first search, on the thread that searches.
+ * @param count : threads per search, 0 for the threads of the OpenCV pool
+ */
+void CascadeBackend::setThreadCount(int count) {
+    if (count <= 0)
+        count = cv::getNumThreads();
+    count = std::max(1, std::min(count, 16));
+    if (!ready || count == threads)
+        return;
+
+    threads = count;
+    copiesLoaded = false;
+    bands.resize(threads);
+}
+
+/**
+ * @brief CascadeBackend::loadCopies : one more copy of the face cascade per thread and one of the eye cascade,
+ * the search stays serial if they can't be loaded
+ * @return true if the search can run on the threads
+ */
+bool CascadeBackend::loadCopies() {
+    if (copiesLoaded)
+        return true;
+
+    bandClassifiers.resize(threads - 1);
+    bool loaded = true;
+    for (cv::CascadeClassifier &classifier : bandClassifiers)
+        loaded = loaded && (!classifier.empty() || CascadeCache::load(classifier, faceCascade));
+    loaded = loaded && (!rightEyeClassifier.empty() || CascadeCache::load(rightEyeClassifier, eyeCascade));
+
+    if (!loaded) {
+        qDebug() << "Could not load the cascades for" << threads << "threads, searching on one";
+        threads = 1;
+        bandClassifiers.clear();
+        bands.resize(threads);
+        return false;
+    }
+    copiesLoaded = true;
+    return true;
+}
+
+/**
+ * @brief CascadeBackend::findFace : run the face cascade on a window of the image
+ * @param gray : 8 bit luminance image
+ * @param window : part of the image to search
+ * @param minSize : smallest face searched
+ * @param maxSize : biggest face searched
+ * @param face : receives the biggest face, in image coordinates
+ * @return true if a face was found
+ */
+bool CascadeBackend::findFace(const cv::Mat &gray, const cv::Rect &window, const cv::Size &minSize, const cv::Size &maxSize, cv::Rect &face) {
+    faces.clear();
+    if (window.empty())
+        return false;
+
+    if (threads > 1 && loadCopies()) {
+        if (!findFaceParallel(gray(window), minSize, maxSize))
+            return false;
+    } else {
+        faceClassifier.detectMultiScale(gray(window), faces, scaleStep, minNeighbors, cv::CASCADE_DO_ROUGH_SEARCH | cv::CASCADE_FIND_BIGGEST_OBJECT,
+                                        minSize, maxSize); //magic
+        if (faces.empty())
+            return false;
+    }
+
+    face = biggest(faces) + window.tl();
+    return true;
+}
+
+/**
+ * @brief CascadeBackend::findFaceParallel : one thread per band of pyramid levels, each collects the raw candidates of
+ * its levels, and the union is grouped the way detectMultiScale groups them. The levels searched and the candidates
+ * are the same as the serial search, so is the result.
+ * @param image : part of the image to search
+ * @param minSize : smallest face searched
+ * @param maxSize : biggest face searched
+ * @return true if faces were found, in faces
+ */
+bool CascadeBackend::findFaceParallel(const cv::Mat &image, const cv::Size &minSize, const cv::Size &maxSize) {
+    splitScales(image.size(), minSize, maxSize);
+
+    cv::parallel_for_(cv::Range(0, int(bands.size())), [&](const cv::Range &range) {
+        for (int i = range.start; i < range.end; i++) {
+            ScaleBand &band = bands[i];
+            band.candidates.clear();
+            if (band.minSize.width < 0)
+                continue; //fewer levels than threads
+            cv::CascadeClassifier &classifier = i == 0 ? faceClassifier : bandClassifiers[i - 1];
+            classifier.detectMultiScale(image, band.candidates, scaleStep, 0, cv::CASCADE_DO_ROUGH_SEARCH, band.minSize, band.maxSize);
+        }
+    });
+
+    //merge in a fixed order, the grouping does not depend on which thread finished first
+    for (const ScaleBand &band : bands)
+        faces.insert(faces.end(), band.candidates.begin(), band.candidates.end());
+    std::sort(faces.begin(), faces.end(), [](const cv::Rect &a, const cv::Rect &b) {
+        if (a.width != b.width)
+            return a.width < b.width;
+        return a.y != b.y ? a.y < b.y : a.x < b.x;
+    });
+    cv::groupRectangles(faces, minNeighbors, groupEps);
+    return !faces.empty();
+}
+
+/**
+ * @brief CascadeBackend::splitScales : cut the pyramid levels detectMultiScale would search into one band per thread.
+ * The cost of a level is the area of the image scaled to it, the small faces cost the most, so the bands are balanced
+ * on that instead of on the number of levels. Bands only split between levels of different window sizes.
+ * @param imageSize : size of the searched image
+ * @param minSize : smallest face searched, empty for no limit
+ * @param maxSize : biggest face searched, empty for no limit
+ */
+void CascadeBackend::splitScales(const cv::Size &imageSize, const cv::Size &minSize, const cv::Size &maxSize) {
+    const cv::Size window = faceClassifier.getOriginalWindowSize();
+    const cv::Size limit = maxSize.area() > 0 ? maxSize : imageSize;
+
+    //same level walk as detectMultiScale
+    std::vector<std::pair<cv::Size, double>> levels; // window size, cost
+    double total = 0.0;
+    for (double factor = 1.0; ; factor *= scaleStep) {
+        cv::Size size(cvRound(window.width * factor), cvRound(window.height * factor));
+        cv::Size scaled(cvRound(imageSize.width / factor), cvRound(imageSize.height / factor));
+        if (size.width > limit.width || size.height > limit.height || scaled.width < window.width || scaled.height < window.height)
+            break;
+        if (size.width < minSize.width || size.height < minSize.height)
+            continue;
+        double cost = double(scaled.area());
+        total += cost;
+        if (!levels.empty() && levels.back().first == size)
+            levels.back().second += cost;
+        else
+            levels.push_back(std::make_pair(size, cost));
+    }
+
+    size_t next = 0;
+    double done = 0.0;
+    for (size_t i = 0; i < bands.size(); i++) {
+        ScaleBand &band = bands[i];
+        if (next >= levels.size()) {
+            band.minSize = cv::Size(-1, -1);
+            continue;
+        }
+        const double target = total * (i + 1) / bands.size();
+        band.minSize = i == 0 ? minSize : levels[next].first;
+        do {
+            done += levels[next].second;
+            next++;
+        } while (next < levels.size() && done + 0.5 * levels[next].second <= target);
+        band.maxSize = next == levels.size() ? maxSize : levels[next - 1].first;
+    }
+}
+
+/**
+ * @brief CascadeBackend::findEyes : run the eye cascade inside the face, the two highest detections are the eyes
+ * @param gray : 8 bit luminance image
+ * @param face : face found in the image
+ * @param leftEye : receives the left eye
+ * @param rightEye : receives the right eye
+ * @return true if both eyes were found
+ */
+bool CascadeBackend::findEyes(const cv::Mat &gray, const cv::Rect &face, cv::Rect2f &leftEye, cv::Rect2f &rightEye) {
+    eyes.clear();
+    cv::Mat faceImg = gray(face);
+
+    if (threads > 1 && loadCopies()) {
+        cv::Rect left, right;
+        if (!findEyesParallel(faceImg, left, right))
+            return false;
+        leftEye = left + face.tl();
+        rightEye = right + face.tl();
+        return true;
+    }
+
+    eyeClassifier.detectMultiScale(faceImg, eyes, 1.1, 3, cv::CASCADE_DO_ROUGH_SEARCH); //more magic
+
+    if (eyes.size() < 2)
+        return false;
+
+    std::sort(eyes.begin(), eyes.end(), [](const cv::Rect& a, const cv::Rect& b) {
+        return (a.y < b.y);
+    });
+
+    cv::Rect eye1 = eyes[0] + face.tl();
+    cv::Rect eye2 = eyes[1] + face.tl();
+    if (eye1.x < eye2.x){
+        leftEye = eye1;
+        rightEye = eye2;
+    } else {
+        leftEye = eye2;
+        rightEye = eye1;
+    }
+    return true;
+}
+
+/**
+ * @brief CascadeBackend::findEyesParallel : search the left and the right half of the face at the same time, the
+ * highest detection of each half is its eye
+ * @param faceImg : the face
+ * @param left : receives the left eye, in face coordinates
+ * @param right : receives the right eye, in face coordinates
+ * @return true if both halves have an eye
+ */
+bool CascadeBackend::findEyesParallel(const cv::Mat &faceImg, cv::Rect &left, cv::Rect &right) {
+    const int half = faceImg.cols / 2;
+    const cv::Rect halves[2] = {cv::Rect(0, 0, half, faceImg.rows), cv::Rect(half, 0, faceImg.cols - half, faceImg.rows)};
+
+    cv::parallel_for_(cv::Range(0, 2), [&](const cv::Range &range) {
+        for (int i = range.start; i < range.end; i++) {
+            std::vector<cv::Rect> &found = i == 0 ? eyes : rightEyes;
+            found.clear();
+            (i == 0 ? eyeClassifier : rightEyeClassifier).detectMultiScale(faceImg(halves[i]), found, 1.1, 3, cv::CASCADE_DO_ROUGH_SEARCH);
+        }
+    });
+
+    if (eyes.empty() || rightEyes.empty())
+        return false;
+    left = highest(eyes);
+    right = highest(rightEyes) + halves[1].tl();
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef CASCADEBACKEND_H
+#define CASCADEBACKEND_H
+
+#include <opencv2/objdetect.hpp>
+#include <vector>
+#include "facedetectorbackend.h"
+
+/**
+ * @brief The CascadeBackend class : face and eye cascade classifiers, Haar or LBP, the cascade file decides
+ */
+class CascadeBackend : public FaceDetectorBackend
+{
+public:
+    CascadeBackend(Kind kind, const QString &faceCascade, const QString &eyeCascade);
+
+    Kind kind() const override;
+    bool isReady() const override;
+    bool loadedFromCache() const override;
+    void setScaleStep(double step) override;
+    void setThreadCount(int count) override;
+
+    bool findFace(const cv::Mat &gray, const cv::Rect &window, const cv::Size &minSize, const cv::Size &maxSize, cv::Rect &face) override;
+    bool findEyes(const cv::Mat &gray, const cv::Rect &face, cv::Rect2f &leftEye, cv::Rect2f &rightEye) override;
+
+private:
+    struct ScaleBand
+    {
+        cv::Size minSize, maxSize;
+        std::vector<cv::Rect> candidates;
+    };
+
+    bool loadCopies();
+    bool findFaceParallel(const cv::Mat &image, const cv::Size &minSize, const cv::Size &maxSize);
+    bool findEyesParallel(const cv::Mat &faceImg, cv::Rect &left, cv::Rect &right);
+    void splitScales(const cv::Size &imageSize, const cv::Size &minSize, const cv::Size &maxSize);
+
+private:
+    Kind backendKind;
+    QString faceCascade, eyeCascade;
+    cv::CascadeClassifier faceClassifier;
+    cv::CascadeClassifier eyeClassifier;
+    bool ready = false;
+    bool fromCache = true;
+    double scaleStep = 1.1;
+
+    // a classifier keeps per search state, every concurrent search needs its own copy, loaded by the first search
+    int threads = 1;
+    bool copiesLoaded = false;
+    std::vector<cv::CascadeClassifier> bandClassifiers;
+    cv::CascadeClassifier rightEyeClassifier;
+    std::vector<ScaleBand> bands;
+
+    std::vector<cv::Rect> faces;
+    std::vector<cv::Rect> eyes;
+    std::vector<cv::Rect> rightEyes;
+};
+
+#endif // CASCADEBACKEND_H
@@ -0,0 +1,118 @@
+#include "cascadecache.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <opencv2/core/version.hpp>
+
+/**
+ * @brief CascadeCache::load : load a cascade from the cache, or from the resource and fill the cache
+ * @param classifier : classifier to load into
+ * @param resource : path of the xml in the resources
+ * @param fromCache : set to true if the cached copy was used
+ * @return true if the classifier was loaded
+ */
+bool CascadeCache::load(cv::CascadeClassifier &classifier, const QString &resource, bool *fromCache) {
+    if (fromCache)
+        *fromCache = false;
+
+    QFile xml(resource);
+    if (!xml.open(QFile::ReadOnly))
+        return false;
+
+    const QString cached = cachePath(resource, xml.size());
+    QFile cachedFile(cached);
+    if (!cached.isEmpty() && cachedFile.open(QFile::ReadOnly)) {
+        if (loadFromMemory(classifier, cachedFile.readAll())) {
+            if (fromCache)
+                *fromCache = true;
+            return true;
+        }
+        qDebug() << "Discarding unreadable cascade cache" << cached;
+        cachedFile.close();
+        cachedFile.remove();
+    }
+
+    const QByteArray data = xml.readAll();
+    if (!loadFromMemory(classifier, data))
+        return false;
+
+    if (!cached.isEmpty() && QDir().mkpath(QFileInfo(cached).path())) {
+        QSaveFile out(cached);
+        if (!out.open(QFile::WriteOnly) || out.write(compact(data)) < 0 || !out.commit())
+            qDebug() << "Can't write cascade cache" << cached;
+    }
+    return true;
+}
+
+/**
+ * @brief CascadeCache::loadFromMemory : parse a cascade xml held in memory
+ * @param classifier : classifier to load into
+ * @param xml
+ * @return true if the classifier was loaded
+ */
+bool CascadeCache::loadFromMemory(cv::CascadeClassifier &classifier, const QByteArray &xml) {
+    if (xml.isEmpty())
+        return false;
+    try {
+        cv::FileStorage storage(std::string(xml.constData(), size_t(xml.size())),
+                                cv::FileStorage::READ | cv::FileStorage::MEMORY);
+        if (!storage.isOpened())
+            return false;
+        return classifier.read(storage.getFirstTopLevelNode()) && !classifier.empty();
+    } catch (const cv::Exception &e) {
+        qDebug() << "Can't parse cascade:" << e.what();
+        return false;
+    }
+}
+
+/**
+ * @brief CascadeCache::compact : the same cascade without comments and indentation, about a third smaller
+ * @param xml
+ * @return the compacted xml
+ */
+QByteArray CascadeCache::compact(const QByteArray &xml) {
+    QByteArray out;
+    out.reserve(xml.size());
+
+    const int n = xml.size();
+    bool space = false;
+    for (int i = 0; i < n; ) {
+        if (xml.at(i) == '<' && xml.mid(i, 4) == "<!--") {
+            int end = xml.indexOf("-->", i + 4);
+            i = end < 0 ? n : end + 3;
+            space = true;
+            continue;
+        }
+
+        char c = xml.at(i++);
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+            space = true;
+            continue;
+        }
+        // one space between values and attributes, none around tags
+        if (space && !out.isEmpty() && !out.endsWith('>') && c != '<')
+            out += ' ';
+        space = false;
+        out += c;
+    }
+    return out;
+}
+
+/**
+ * @brief CascadeCache::cachePath : where the compacted copy of a resource is kept. The name carries the resource size,
+ * the app and the OpenCV versions, so a new build or a new cascade never reads a stale copy.
+ * @param resource
+ * @param resourceSize
+ * @return the path, empty if the platform has no app data directory
+ */
+QString CascadeCache::cachePath(const QString &resource, qint64 resourceSize) {
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (dir.isEmpty())
+        return QString();
+    return QString("%1/cascades/%2-%3-%4-%5.min.xml").arg(dir, QFileInfo(resource).completeBaseName())
+            .arg(resourceSize).arg(QCoreApplication::applicationVersion(), CV_VERSION);
+}
@@ -0,0 +1,22 @@
+#ifndef CASCADECACHE_H
+#define CASCADECACHE_H
+
+#include <QByteArray>
+#include <QString>
+#include <opencv2/objdetect.hpp>
+
+/**
+ * @brief The CascadeCache class : loads cascade classifiers straight from memory, no temporary files.
+ * The first run stores a compacted copy of each cascade in the app data directory, later runs parse that instead
+ * of the full resource.
+ */
+class CascadeCache
+{
+public:
+    static bool load(cv::CascadeClassifier &classifier, const QString &resource, bool *fromCache = nullptr);
+    static bool loadFromMemory(cv::CascadeClassifier &classifier, const QByteArray &xml);
+    static QByteArray compact(const QByteArray &xml);
+    static QString cachePath(const QString &resource, qint64 resourceSize);
+};
+
+#endif // CASCADECACHE_H
@@ -0,0 +1,130 @@
+#include "detectiongovernor.h"
+#include <algorithm>
+
+const float DetectionGovernor::levels[DetectionGovernor::levelCount] = {0.5f, 0.625f, 0.75f, 0.875f, 1.0f};
+
+/**
+ * @brief DetectionGovernor::configure : set the targets and start again from full resolution
+ * @param latencyBudgetMs : detection time per frame to hold
+ * @param minRate : detections per second never gone below
+ * @param maxRate : detections per second when there is time left
+ */
+void DetectionGovernor::configure(float latencyBudgetMs, int minRate, int maxRate) {
+    budgetMs = latencyBudgetMs;
+    this->minRate = qMax(1, minRate);
+    this->maxRate = qMax(this->minRate, maxRate);
+    reset();
+}
+
+/**
+ * @brief DetectionGovernor::reset : full resolution, finest scale step, highest rate
+ */
+void DetectionGovernor::reset() {
+    level = levelCount - 1;
+    current = Decision();
+    current.rate = maxRate;
+    averageMs = 0.0;
+    framesSinceDecision = 0;
+    stableFrames = 0;
+    publish();
+}
+
+/**
+ * @brief DetectionGovernor::update : account for one detected frame, and adjust every few frames
+ * @param frameNs : time the frame took, conversion and detection
+ * @param pose : what was found, its coordinates relative to pose.imageSize
+ * @param eyesFromFlow : the eyes were followed by optical flow, not searched
+ * @return true if the decision changed
+ */
+bool DetectionGovernor::update(qint64 frameNs, const HeadPose &pose, bool eyesFromFlow) {
+    double ms = frameNs / 1e6;
+    averageMs = averageMs > 0.0 ? averageMs + 0.2 * (ms - averageMs) : ms;
+    stableFrames = pose.hasEyes() && eyesFromFlow ? stableFrames + 1 : 0;
+
+    if (++framesSinceDecision < decisionInterval)
+        return false;
+    framesSinceDecision = 0;
+
+    const float faceFraction = pose.hasFace() && pose.imageSize.width() > 0
+            ? float(pose.face.width()) / pose.imageSize.width() : 0.0f;
+    const bool wantDetail = faceFraction < 0.25f;  // lost, small or far away
+    const bool canCoarsen = faceFraction > 0.45f && stableFrames >= decisionInterval;
+    const bool overBudget = averageMs > budgetMs;
+    const bool budgetLeft = averageMs < 0.6 * budgetMs;
+
+    const Decision before = current;
+    const int levelBefore = level;
+
+    if (overBudget) {
+        // Cheapest loss first: coarser pyramid, then pixels the face does not need, then fewer detections
+        if (current.scaleStep < 1.29)
+            current.scaleStep += 0.05;
+        else if (level > 0 && !wantDetail)
+            level--;
+        else if (current.rate > minRate)
+            current.rate = qMax(minRate, current.rate - 5);
+        else if (level > 0)
+            level--;
+    } else if (canCoarsen) {
+        // A big face held by the flow tracker needs neither the pixels nor the rate
+        if (level > 0)
+            level--;
+        else if (current.rate > minRate)
+            current.rate = qMax(minRate, current.rate - 5);
+    } else if (wantDetail && level < levelCount - 1 && averageMs < 0.8 * budgetMs) {
+        level++;
+    } else if (budgetLeft) {
+        if (current.rate < maxRate)
+            current.rate = qMin(maxRate, current.rate + 5);
+        else if (current.scaleStep > 1.11)
+            current.scaleStep -= 0.05;
+        else if (level < levelCount - 1)
+            level++;
+    }
+
+    current.resolution = levels[level];
+    if (level == levelBefore && current.rate == before.rate && current.scaleStep == before.scaleStep)
+        return false;
+
+    averageMs = 0.0; //measure the new setting on its own
+    publish();
+    return true;
+}
+
+/**
+ * @brief DetectionGovernor::decision
+ * @return the current choice, detection thread only
+ */
+const DetectionGovernor::Decision &DetectionGovernor::decision() const {
+    return current;
+}
+
+/**
+ * @brief DetectionGovernor::currentResolution : thread safe
+ * @return fraction of the largest detection size
+ */
+float DetectionGovernor::currentResolution() const {
+    return resolutionPermille.load(std::memory_order_relaxed) / 1000.0f;
+}
+
+/**
+ * @brief DetectionGovernor::currentScaleStep : thread safe
+ * @return cascade scale factor
+ */
+double DetectionGovernor::currentScaleStep() const {
+    return scaleStepPermille.load(std::memory_order_relaxed) / 1000.0;
+}
+
+/**
+ * @brief DetectionGovernor::currentRate : thread safe
+ * @return detections per second
+ */
+int DetectionGovernor::currentRate() const {
+    return ratePublished.load(std::memory_order_relaxed);
+}
+
+void DetectionGovernor::publish() {
+    resolutionPermille.store(int(current.resolution * 1000.0f + 0.5f), std::memory_order_relaxed);
+    scaleStepPermille.store(int(current.scaleStep * 1000.0 + 0.5), std::memory_order_relaxed);
+    ratePublished.store(current.rate, std::memory_order_relaxed);
+}
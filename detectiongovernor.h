@@ -0,0 +1,54 @@
+#ifndef DETECTIONGOVERNOR_H
+#define DETECTIONGOVERNOR_H
+
+#include <QtGlobal>
+#include <atomic>
+#include "headpose.h"
+
+/**
+ * @brief The DetectionGovernor class : picks the detection resolution, the cascade scale step and the detection rate
+ * so the measured detection time stays inside a budget. More resolution when the face is small or lost, less when it is
+ * big and followed steadily. Runs on the detection thread, the current choice can be read from any thread.
+ */
+class DetectionGovernor
+{
+public:
+    struct Decision
+    {
+        float resolution = 1.0f;    // fraction of the largest detection size
+        double scaleStep = 1.1;     // cascade scale factor between pyramid levels
+        int rate = 30;              // detections per second
+    };
+
+    void configure(float latencyBudgetMs, int minRate, int maxRate);
+    void reset();
+    bool update(qint64 frameNs, const HeadPose &pose, bool eyesFromFlow);
+    const Decision &decision() const;
+
+    float currentResolution() const;
+    double currentScaleStep() const;
+    int currentRate() const;
+
+private:
+    void publish();
+
+private:
+    static const int levelCount = 5;
+    static const float levels[levelCount];
+    static const int decisionInterval = 10; // frames between two adjustments
+
+    float budgetMs = 25.0f;
+    int minRate = 10, maxRate = 30;
+
+    Decision current;
+    int level = levelCount - 1;
+    double averageMs = 0.0;
+    int framesSinceDecision = 0;
+    int stableFrames = 0;
+
+    std::atomic<int> resolutionPermille{1000};
+    std::atomic<int> scaleStepPermille{1100};
+    std::atomic<int> ratePublished{30};
+};
+
+#endif // DETECTIONGOVERNOR_H
@@ -0,0 +1,500 @@
+#include "detectionworker.h"
+#include <QDebug>
+
+// Per frame logging allocates, it is only compiled in on request (DEFINES += DETECTION_VERBOSE)
+#ifdef DETECTION_VERBOSE
+#define detectionLog qDebug
+#else
+#define detectionLog QT_NO_QDEBUG_MACRO
+#endif
+
+/**
+ * @brief DetectionWorker::DetectionWorker : constructor, the detector backend is loaded later on the detection thread
+ * @param detectionSize : size of the upright image the cascades run on, the largest one when adaptive detection is on
+ * @param output : where every detected HeadPose is published
+ * @param parent
+ */
+DetectionWorker::DetectionWorker(const QSize &detectionSize, TripleBuffer<HeadPose> &output, QObject *parent) :
+    QObject(parent),
+    maxDetectionSize(detectionSize),
+    detectionSize(detectionSize),
+    poseOutput(output)
+{
+}
+
+/**
+ * @brief DetectionWorker::loadBackend : create the backend of the settings. If it can't be loaded the current one is
+ * kept, or the Haar cascades are used when there is none yet.
+ * @param settings
+ */
+void DetectionWorker::loadBackend(const TrackingSettings &settings) {
+    qint64 start = monotonicNs();
+    std::unique_ptr<FaceDetectorBackend> candidate(FaceDetectorBackend::create(settings.detector, settings.detectorModel));
+    if (!candidate->isReady()) {
+        if (backend) {
+            qDebug() << "Keeping the" << FaceDetectorBackend::kindName(backend->kind()) << "detector, the"
+                     << FaceDetectorBackend::kindName(settings.detector) << "one is not available";
+            return;
+        }
+        if (settings.detector != FaceDetectorBackend::Haar) {
+            qDebug() << "The" << FaceDetectorBackend::kindName(settings.detector) << "detector is not available, using haar";
+            candidate.reset(FaceDetectorBackend::create(FaceDetectorBackend::Haar));
+        }
+    }
+
+    backend = std::move(candidate);
+    detectorLoadNs.store(monotonicNs() - start);
+    detectorFromCache.store(backend->loadedFromCache());
+    detectorKind.store(backend->kind());
+}
+
+/**
+ * @brief DetectionWorker::setBackend : use this detector instead of the one of the settings, until the settings ask
+ * for another kind or model. Same threading rules as setTrackingSettings().
+ * @param detector : ready backend, takes ownership
+ */
+void DetectionWorker::setBackend(FaceDetectorBackend *detector) {
+    backend.reset(detector);
+    backend->setThreadCount(tracking.detectionThreads);
+    backend->setScaleStep(governor.decision().scaleStep);
+    detectorLoadNs.store(0);
+    detectorFromCache.store(backend->loadedFromCache());
+    detectorKind.store(backend->kind());
+}
+
+/**
+ * @brief DetectionWorker::getDetectorLoadMs
+ * @return time spent loading the current detector backend, readable from any thread
+ */
+double DetectionWorker::getDetectorLoadMs() const {
+    return detectorLoadNs.load() / 1e6;
+}
+
+/**
+ * @brief DetectionWorker::detectorLoadedFromCache
+ * @return true if the models of the current backend came from the cascade cache instead of the resources,
+ * readable from any thread
+ */
+bool DetectionWorker::detectorLoadedFromCache() const {
+    return detectorFromCache.load();
+}
+
+/**
+ * @brief DetectionWorker::getDetector
+ * @return the backend in use, it can differ from the settings when the requested one could not be loaded,
+ * readable from any thread
+ */
+FaceDetectorBackend::Kind DetectionWorker::getDetector() const {
+    return FaceDetectorBackend::Kind(detectorKind.load());
+}
+
+/**
+ * @brief DetectionWorker::getGovernor
+ * @return the resolution, scale step and rate picked by the adaptive detection, readable from any thread
+ */
+const DetectionGovernor &DetectionWorker::getGovernor() const {
+    return governor;
+}
+
+/**
+ * @brief DetectionWorker::getRateSkippedCount
+ * @return number of frames the adaptive detection skipped to hold its detection rate
+ */
+quint64 DetectionWorker::getRateSkippedCount() const {
+    return rateSkipped.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief DetectionWorker::getGatedCount
+ * @return number of frames that reused the last pose because nothing moved
+ */
+quint64 DetectionWorker::getGatedCount() const {
+    return gated.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief DetectionWorker::enqueue : hand a frame to the detection thread, called from the frame source thread.
+ * Returns right away so the source can capture the next frame while this one is detected.
+ * @param frame
+ */
+void DetectionWorker::enqueue(const LumaFrame &frame) {
+    queue.push(frame);
+}
+
+/**
+ * @brief DetectionWorker::requestStop : make run() return, can be called from any thread
+ */
+void DetectionWorker::requestStop() {
+    queue.interrupt();
+}
+
+/**
+ * @brief DetectionWorker::run : detection loop, runs on the detection thread until requestStop().
+ * Sleeps on the queue instead of posting an event per frame, so a steady stream of frames allocates nothing.
+ */
+void DetectionWorker::run() {
+    LumaFrame frame;
+    while (queue.waitPop(frame)) {
+        if (settingsChanged.exchange(false)) {
+            QMutexLocker locker(&settingsMutex);
+            setTrackingSettings(pendingSettings);
+        }
+        processFrame(frame);
+        frame = LumaFrame(); //give the camera buffer back before sleeping
+    }
+}
+
+/**
+ * @brief DetectionWorker::processFrame : find the face and eyes in a frame and publish the pose, runs on the detection thread.
+ * When the motion gate sees no change around the face since the last detection, the last pose is published again instead.
+ * @param frame : luminance frame from the frame source
+ */
+void DetectionWorker::processFrame(const LumaFrame &frame) {
+    if (tracking.adaptiveDetection) {
+        //the renderer keeps the last pose for the frames between two detections
+        if (lastDetectionNs && frame.timestampNs - lastDetectionNs < 1000000000LL / governor.decision().rate) {
+            rateSkipped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        lastDetectionNs = frame.timestampNs;
+    }
+
+    qint64 start = monotonicNs();
+    const cv::Mat *img;
+    {
+        ScopedStageTimer timer(convertStats, HotPathTrace::Convert);
+        img = &preprocessor.process(frame, cv::Size(detectionSize.width(), detectionSize.height()));
+    }
+
+    bool still = false;
+    if (tracking.motionGating) {
+        ScopedStageTimer timer(motionGateStats, HotPathTrace::MotionGate);
+        still = motionGate.isStatic(*img);
+    }
+
+    HeadPose pose;
+    if (still) {
+        //nothing moved since the last detection, its result still holds
+        pose = lastPose;
+        pose.sequence = frame.sequence;
+        pose.timestampNs = frame.timestampNs;
+        gated.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        pose = detect(*img, frame.sequence, frame.timestampNs);
+        if (tracking.motionGating) {
+            motionGate.setReference(*img, trackedFace);
+            lastPose = pose;
+        }
+    }
+    {
+        ScopedStageTimer timer(publishStats, HotPathTrace::PosePublish);
+        poseOutput.publish(pose);
+    }
+
+    if (!still && tracking.adaptiveDetection && governor.update(monotonicNs() - start, pose, eyesFromFlow))
+        applyGovernor();
+
+    //the receiver reads the latest pose, one wakeup covers all the frames published before it handles it
+    if (!wakeupPending.exchange(true))
+        emit frameProcessed();
+}
+
+/**
+ * @brief DetectionWorker::acknowledgeFrameProcessed : the receiver of frameProcessed handled it, the next published
+ * pose emits it again. Call it before reading the pose so none is missed, from any thread.
+ */
+void DetectionWorker::acknowledgeFrameProcessed() {
+    wakeupPending.store(false);
+}
+
+/**
+ * @brief DetectionWorker::applyGovernor : switch to the resolution and scale step the governor picked.
+ * The tracked face follows the new resolution, the flow points do not and start over.
+ */
+void DetectionWorker::applyGovernor() {
+    const DetectionGovernor::Decision &decision = governor.decision();
+    QSize size(qRound(maxDetectionSize.width() * decision.resolution), qRound(maxDetectionSize.height() * decision.resolution));
+    if (size != detectionSize) {
+        float scale = float(size.width()) / detectionSize.width();
+        trackedFace = cv::Rect(cvRound(trackedFace.x * scale), cvRound(trackedFace.y * scale),
+                               cvRound(trackedFace.width * scale), cvRound(trackedFace.height * scale));
+        eyeTracker.reset();
+        motionGate.reset();
+        detectionSize = size;
+    }
+    backend->setScaleStep(decision.scaleStep);
+
+    detectionLog() << "governor:" << detectionSize << "scale step" << decision.scaleStep << "rate" << decision.rate;
+}
+
+/**
+ * @brief DetectionWorker::detect : run the face and eye cascades on a gray image
+ * @param gray : 8 bit luminance image
+ * @param sequence : frame number
+ * @param timestampNs : capture time
+ * @return the pose found in the image, in the coordinates of the largest detection size when gray is a reduced one,
+ * so the distance estimate does not depend on the resolution the governor picked
+ */
+HeadPose DetectionWorker::detect(const cv::Mat &gray, quint64 sequence, qint64 timestampNs) {
+    //no settings were given before the first frame: the default backend
+    if (!backend)
+        setTrackingSettings(tracking);
+
+    ScopedStageTimer timer(detectStats);
+
+    HeadPose pose;
+    pose.imageSize = QSize(gray.cols, gray.rows);
+    float scale = 1.0f;
+    if (gray.cols < maxDetectionSize.width()) {
+        scale = float(maxDetectionSize.width()) / gray.cols;
+        pose.imageSize = maxDetectionSize;
+    }
+    pose.sequence = sequence;
+    pose.timestampNs = timestampNs;
+
+    //detecting faces and eyes:
+    cv::Rect cvface;
+    cv::Rect2f cvleft, cvright;
+
+    if (findFace(gray, cvface)) {
+        pose.state = HeadPose::FaceOnly;
+        pose.face = QRect(qRound(cvface.x * scale), qRound(cvface.y * scale), qRound(cvface.width * scale), qRound(cvface.height * scale));
+
+        if (findEyes(gray, cvface, cvleft, cvright)) {
+            pose.leftEye = QRectF(cvleft.x * scale, cvleft.y * scale, cvleft.width * scale, cvleft.height * scale);
+            pose.rightEye = QRectF(cvright.x * scale, cvright.y * scale, cvright.width * scale, cvright.height * scale);
+            ScopedStageTimer timer(distanceStats, HotPathTrace::Distance);
+            pose.distanceFromCamera = calculateDistance(pose.leftEye, pose.rightEye);
+            if (pose.distanceFromCamera > 0.0f)
+                pose.state = HeadPose::FaceAndEyes;
+        }
+    } else {
+        eyeTracker.reset();
+    }
+
+    detectionLog() << "face: " << pose.face;
+    detectionLog() << "right eye: " << pose.rightEye;
+    detectionLog() << "left eye: " << pose.leftEye;
+
+    return pose;
+}
+
+/**
+ * @brief DetectionWorker::findFace : run the face detector. While a face is tracked only a window around it and a narrow
+ * band of sizes are searched, the whole frame is searched every reacquireInterval frames or when the track is lost.
+ * @param gray : 8 bit luminance image
+ * @param face : receives the biggest face found
+ * @return true if a face was found
+ */
+bool DetectionWorker::findFace(const cv::Mat &gray, cv::Rect &face) {
+
+    bool roiSearch = tracking.roiTracking && !trackedFace.empty() && framesSinceFullSearch < tracking.reacquireInterval;
+    if (roiSearch) {
+        ScopedStageTimer timer(roiSearchStats, HotPathTrace::FaceDetect);
+        framesSinceFullSearch++;
+
+        int marginX = cvRound(trackedFace.width * tracking.searchMargin);
+        int marginY = cvRound(trackedFace.height * tracking.searchMargin);
+        cv::Rect window(trackedFace.x - marginX, trackedFace.y - marginY,
+                        trackedFace.width + 2 * marginX, trackedFace.height + 2 * marginY);
+        window &= cv::Rect(0, 0, gray.cols, gray.rows);
+
+        cv::Size minSize(cvRound(trackedFace.width * (1.0f - tracking.scaleBand)), cvRound(trackedFace.height * (1.0f - tracking.scaleBand)));
+        cv::Size maxSize(cvRound(trackedFace.width * (1.0f + tracking.scaleBand)), cvRound(trackedFace.height * (1.0f + tracking.scaleBand)));
+
+        if (backend->findFace(gray, window, minSize, maxSize, face)) {
+            trackedFace = face;
+            return true;
+        }
+        //lost the track, look everywhere right away
+    }
+
+    ScopedStageTimer timer(fullSearchStats, HotPathTrace::FaceDetect);
+    framesSinceFullSearch = 0;
+
+    if (!backend->findFace(gray, cv::Rect(0, 0, gray.cols, gray.rows), cv::Size(), cv::Size(), face)) {
+        trackedFace = cv::Rect();
+        return false;
+    }
+
+    trackedFace = face;
+    return true;
+}
+
+/**
+ * @brief DetectionWorker::findEyes : follow the eyes with optical flow, or locate the pupils (or run the eye detector)
+ * when the flow lost them. Pupils are returned as eye boxes centered on them.
+ * @param gray : 8 bit luminance image
+ * @param face : the face found in this frame
+ * @param leftEye : receives the left eye
+ * @param rightEye : receives the right eye
+ * @return true if both eyes were found
+ */
+bool DetectionWorker::findEyes(const cv::Mat &gray, const cv::Rect &face, cv::Rect2f &leftEye, cv::Rect2f &rightEye) {
+    eyesFromFlow = false;
+    if (tracking.eyeFlowTracking && eyeTracker.isTracking()) {
+        ScopedStageTimer timer(eyeFlowStats, HotPathTrace::EyeDetect);
+        cv::Rect2f faceArea(face);
+        if (eyeTracker.track(gray, leftEye, rightEye)
+                && faceArea.contains((leftEye.tl() + leftEye.br()) * 0.5f)
+                && faceArea.contains((rightEye.tl() + rightEye.br()) * 0.5f)) {
+            eyesFromFlow = true;
+            return true;
+        }
+        eyeTracker.reset(); //the flow drifted or lost its points, back to the detector
+    }
+
+    ScopedStageTimer timer(eyeCascadeStats, HotPathTrace::EyeDetect);
+    // Landmarks of the detector beat the face proportions the pupil search assumes, which fit the cascade faces
+    if (tracking.pupilLocalization && !backend->providesEyes()) {
+        cv::Point2f left, right;
+        if (!pupilLocator.locate(gray, face, left, right))
+            return false;
+        const float size = face.width * 0.2f; //about the size of an eye cascade detection
+        leftEye = cv::Rect2f(left.x - 0.5f * size, left.y - 0.5f * size, size, size);
+        rightEye = cv::Rect2f(right.x - 0.5f * size, right.y - 0.5f * size, size, size);
+    } else if (!backend->findEyes(gray, face, leftEye, rightEye)) {
+        return false;
+    }
+
+    if (tracking.eyeFlowTracking) {
+        eyeTracker.setMinConfidence(tracking.minFlowConfidence);
+        eyeTracker.seed(gray, leftEye, rightEye);
+    }
+    return true;
+}
+
+/**
+ * @brief DetectionWorker::calculateDistance: Rough estimation of the distance between the camera and the face
+ * @param leftEye
+ * @param rightEye
+ * @return distance from camera
+ */
+float DetectionWorker::calculateDistance(const QRectF &leftEye, const QRectF &rightEye) {
+
+    /*
+     * Estimation model:
+     * l = 1470 / d
+     *
+     * l : distance between face and camera
+     * d : distance between both eyes
+     */
+
+    float eyeDistance = float(rightEye.center().x() - leftEye.center().x()); //centers, the boxes can differ in size
+    return eyeDistance > 0.0f ? 1470.0f / eyeDistance : 0.0f;
+}
+
+/**
+ * @brief DetectionWorker::getQueue
+ * @return the queue between the frame source and the detection thread
+ */
+FrameQueue &DetectionWorker::getQueue() {
+    return queue;
+}
+
+/**
+ * @brief DetectionWorker::setTrackingSettings : must be called on the detection thread, or when no thread runs the worker
+ * @param settings
+ */
+void DetectionWorker::setTrackingSettings(const TrackingSettings &settings) {
+    if (!backend || settings.detector != backend->kind() || settings.detectorModel != tracking.detectorModel)
+        loadBackend(settings);
+
+    backend->setThreadCount(settings.detectionThreads);
+    tracking = settings;
+    preprocessor.setEqualizeHistogram(settings.equalizeHistogram);
+    trackedFace = cv::Rect();
+    eyeTracker.reset();
+
+    motionGate.reset();
+    motionGate.setThreshold(settings.motionThreshold);
+    motionGate.setMaxGatedFrames(settings.maxGatedFrames);
+
+    //adaptive or not, start over from the largest size and the finest scale step
+    governor.configure(settings.latencyBudgetMs, settings.minDetectionRate, settings.maxDetectionRate);
+    detectionSize = maxDetectionSize;
+    lastDetectionNs = 0;
+    backend->setScaleStep(governor.decision().scaleStep);
+}
+
+/**
+ * @brief DetectionWorker::requestTrackingSettings : thread safe, the settings are applied before the next frame
+ * @param settings
+ */
+void DetectionWorker::requestTrackingSettings(const TrackingSettings &settings) {
+    QMutexLocker locker(&settingsMutex);
+    pendingSettings = settings;
+    settingsChanged = true;
+}
+
+/**
+ * @brief DetectionWorker::getConvertStats
+ * @return timing of the luma conversion, scaling and rotation to the detection size
+ */
+const StageStats &DetectionWorker::getConvertStats() const {
+    return convertStats;
+}
+
+/**
+ * @brief DetectionWorker::getMotionGateStats
+ * @return timing of the comparison with the last detected frame
+ */
+const StageStats &DetectionWorker::getMotionGateStats() const {
+    return motionGateStats;
+}
+
+/**
+ * @brief DetectionWorker::getDetectStats
+ * @return timing of the face and eye cascades
+ */
+const StageStats &DetectionWorker::getDetectStats() const {
+    return detectStats;
+}
+
+/**
+ * @brief DetectionWorker::getRoiSearchStats
+ * @return timing of the face searches limited to the window around the tracked face
+ */
+const StageStats &DetectionWorker::getRoiSearchStats() const {
+    return roiSearchStats;
+}
+
+/**
+ * @brief DetectionWorker::getFullSearchStats
+ * @return timing of the full frame face searches
+ */
+const StageStats &DetectionWorker::getFullSearchStats() const {
+    return fullSearchStats;
+}
+
+/**
+ * @brief DetectionWorker::getEyeCascadeStats
+ * @return timing of the eye cascade
+ */
+const StageStats &DetectionWorker::getEyeCascadeStats() const {
+    return eyeCascadeStats;
+}
+
+/**
+ * @brief DetectionWorker::getEyeFlowStats
+ * @return timing of the optical flow eye updates
+ */
+const StageStats &DetectionWorker::getEyeFlowStats() const {
+    return eyeFlowStats;
+}
+
+/**
+ * @brief DetectionWorker::getDistanceStats
+ * @return timing of the distance estimation
+ */
+const StageStats &DetectionWorker::getDistanceStats() const {
+    return distanceStats;
+}
+
+/**
+ * @brief DetectionWorker::getPublishStats
+ * @return timing of the hand-off of the pose to the renderer
+ */
+const StageStats &DetectionWorker::getPublishStats() const {
+    return publishStats;
+}
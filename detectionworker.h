@@ -0,0 +1,143 @@
+#ifndef DETECTIONWORKER_H
+#define DETECTIONWORKER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QRect>
+#include <QSize>
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <memory>
+#include "detectiongovernor.h"
+#include "eyeflowtracker.h"
+#include "facedetectorbackend.h"
+#include "framepreprocessor.h"
+#include "framequeue.h"
+#include "headpose.h"
+#include "lumaframe.h"
+#include "motiongate.h"
+#include "pupillocator.h"
+#include "stagestats.h"
+#include "triplebuffer.h"
+
+struct TrackingSettings
+{
+    bool roiTracking = true;    // search around the last face instead of the whole frame
+    float searchMargin = 0.5f;  // the search window is the last face grown by this fraction of its size on each side
+    float scaleBand = 0.2f;     // only faces within this fraction of the last face size are searched
+    int reacquireInterval = 15; // full frame search every N frames even while the track holds
+    bool eyeFlowTracking = true;    // follow the eyes with optical flow between eye cascade detections
+    float minFlowConfidence = 0.6f; // fraction of flow points that must survive before the eye cascade runs again
+    bool pupilLocalization = true;  // eyes from the pupil gradients in the expected eye regions instead of the eye cascade,
+                                    // backends with eye landmarks always use them
+    bool equalizeHistogram = false; // stretch the contrast of every frame before detection
+    FaceDetectorBackend::Kind detector = FaceDetectorBackend::Haar;
+    QString detectorModel;          // face model of the Lbp and Dnn detectors, see FaceDetectorBackend::create()
+    int detectionThreads = 0;       // threads one face or eye search is split over, 0: one per core, 1: serial
+    bool adaptiveDetection = false; // let the DetectionGovernor pick resolution, scale step and rate
+    float latencyBudgetMs = 25.0f;  // detection time per frame the governor holds
+    int maxDetectionRate = 30;      // detections per second, frames in between are skipped
+    int minDetectionRate = 10;
+    bool motionGating = true;       // reuse the last pose while the face region does not change
+    float motionThreshold = 2.0f;   // mean gray level difference of the region thumbnails that counts as motion
+    int maxGatedFrames = 30;        // detect at least every N frames even when nothing moves
+};
+
+class DetectionWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DetectionWorker(const QSize &detectionSize, TripleBuffer<HeadPose> &output, QObject *parent = nullptr);
+
+    void enqueue(const LumaFrame &frame);
+    void requestStop();
+    void processFrame(const LumaFrame &frame);
+    HeadPose detect(const cv::Mat &gray, quint64 sequence, qint64 timestampNs);
+
+    FrameQueue &getQueue();
+    void setBackend(FaceDetectorBackend *detector);
+    void setTrackingSettings(const TrackingSettings &settings);
+    void requestTrackingSettings(const TrackingSettings &settings);
+
+    const StageStats &getConvertStats() const;
+    const StageStats &getDetectStats() const;
+    const StageStats &getRoiSearchStats() const;
+    const StageStats &getFullSearchStats() const;
+    const StageStats &getEyeCascadeStats() const;
+    const StageStats &getEyeFlowStats() const;
+    const StageStats &getDistanceStats() const;
+    const StageStats &getPublishStats() const;
+    FaceDetectorBackend::Kind getDetector() const;
+    double getDetectorLoadMs() const;
+    bool detectorLoadedFromCache() const;
+    const DetectionGovernor &getGovernor() const;
+    quint64 getRateSkippedCount() const;
+    quint64 getGatedCount() const;
+    const StageStats &getMotionGateStats() const;
+
+    void acknowledgeFrameProcessed();
+
+public slots:
+    void run();
+
+signals:
+    void frameProcessed(); // not emitted again until acknowledgeFrameProcessed()
+
+private:
+    bool findFace(const cv::Mat &gray, cv::Rect &face);
+    bool findEyes(const cv::Mat &gray, const cv::Rect &face, cv::Rect2f &leftEye, cv::Rect2f &rightEye);
+    float calculateDistance(const QRectF &leftEye, const QRectF &rightEye);
+    void applyGovernor();
+    void loadBackend(const TrackingSettings &settings);
+
+private:
+    const QSize maxDetectionSize;
+    QSize detectionSize;
+    TripleBuffer<HeadPose> &poseOutput;
+
+    FrameQueue queue;
+
+    QMutex settingsMutex;
+    TrackingSettings pendingSettings;
+    std::atomic<bool> settingsChanged{false};
+
+    // at most one frameProcessed in flight, a queued signal allocates its event
+    std::atomic<bool> wakeupPending{false};
+
+    FramePreprocessor preprocessor;
+
+    TrackingSettings tracking;
+    // created on the detection thread by the first detection, or by setTrackingSettings()
+    std::unique_ptr<FaceDetectorBackend> backend;
+
+    // what the backend is, for the other threads
+    std::atomic<int> detectorKind{FaceDetectorBackend::Haar};
+    std::atomic<qint64> detectorLoadNs{0};
+    std::atomic<bool> detectorFromCache{false};
+
+    cv::Rect trackedFace;
+    int framesSinceFullSearch = 0;
+    EyeFlowTracker eyeTracker;
+    PupilLocator pupilLocator;
+    bool eyesFromFlow = false;
+
+    DetectionGovernor governor;
+    qint64 lastDetectionNs = 0;
+    std::atomic<quint64> rateSkipped{0};
+
+    MotionGate motionGate;
+    HeadPose lastPose;
+    std::atomic<quint64> gated{0};
+
+    StageStats convertStats;
+    StageStats motionGateStats;
+    StageStats detectStats;
+    StageStats roiSearchStats;
+    StageStats fullSearchStats;
+    StageStats eyeCascadeStats;
+    StageStats eyeFlowStats;
+    StageStats distanceStats;
+    StageStats publishStats;
+};
+
+#endif // DETECTIONWORKER_H
@@ -0,0 +1,127 @@
+#include "dnnfacebackend.h"
+#include <QDebug>
+#include <QFile>
+#include <opencv2/imgproc.hpp>
+#include <cmath>
+
+/**
+ * @brief DnnFaceBackend::DnnFaceBackend : constructor, loads the network
+ * @param model : file path of the YuNet onnx model (face_detection_yunet_2023mar.onnx from the OpenCV model zoo)
+ */
+DnnFaceBackend::DnnFaceBackend(const QString &model)
+{
+#ifdef HAVE_FACE_DETECTOR_YN
+    if (model.isEmpty() || !QFile::exists(model)) {
+        qDebug() << "DNN face detector needs the path of a YuNet model, got" << model;
+        return;
+    }
+    try {
+        detector = cv::FaceDetectorYN::create(model.toStdString(), "", cv::Size(320, 320), 0.6f, 0.3f, 20);
+        qDebug() << "Successfully loaded DNN face detector!" << model;
+    } catch (const cv::Exception &e) {
+        qDebug() << "Could not load DNN face detector:" << e.what();
+        detector.release();
+    }
+#else
+    Q_UNUSED(model);
+    qDebug() << "DNN face detector needs OpenCV 4.5.4 or newer, this build has" << CV_VERSION;
+#endif
+}
+
+/**
+ * @brief DnnFaceBackend::kind
+ * @return Dnn
+ */
+FaceDetectorBackend::Kind DnnFaceBackend::kind() const {
+    return Dnn;
+}
+
+/**
+ * @brief DnnFaceBackend::providesEyes
+ * @return true, the network gives the eye landmarks with the face
+ */
+bool DnnFaceBackend::providesEyes() const {
+    return true;
+}
+
+/**
+ * @brief DnnFaceBackend::isReady
+ * @return true if the network was loaded
+ */
+bool DnnFaceBackend::isReady() const {
+#ifdef HAVE_FACE_DETECTOR_YN
+    return !detector.empty();
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief DnnFaceBackend::findFace : run the network on a window of the image, and keep the eye landmarks of the biggest face
+ * @param gray : 8 bit luminance image
+ * @param window : part of the image to search
+ * @param minSize : smallest face kept
+ * @param maxSize : biggest face kept
+ * @param face : receives the biggest face, in image coordinates
+ * @return true if a face was found
+ */
+bool DnnFaceBackend::findFace(const cv::Mat &gray, const cv::Rect &window, const cv::Size &minSize, const cv::Size &maxSize, cv::Rect &face) {
+    lastFace = cv::Rect();
+#ifdef HAVE_FACE_DETECTOR_YN
+    if (detector.empty() || window.empty())
+        return false;
+
+    //the network was trained on color images, the gray channel is repeated
+    cv::cvtColor(gray(window), color, cv::COLOR_GRAY2BGR);
+    detector->setInputSize(color.size());
+    detector->detect(color, detections);
+
+    //one row per face: x, y, w, h, right eye, left eye, nose, mouth corners, score
+    float bestArea = 0.0f;
+    for (int i = 0; i < detections.rows; i++) {
+        const float *row = detections.ptr<float>(i);
+        cv::Rect candidate(cvRound(row[0]), cvRound(row[1]), cvRound(row[2]), cvRound(row[3]));
+        if ((!minSize.empty() && (candidate.width < minSize.width || candidate.height < minSize.height))
+                || (!maxSize.empty() && (candidate.width > maxSize.width || candidate.height > maxSize.height)))
+            continue;
+        if (candidate.area() <= bestArea)
+            continue;
+
+        bestArea = float(candidate.area());
+        lastFace = (candidate + window.tl()) & cv::Rect(0, 0, gray.cols, gray.rows);
+        cv::Point2f a(row[4] + window.x, row[5] + window.y), b(row[6] + window.x, row[7] + window.y);
+        lastLeftEye = a.x < b.x ? a : b;
+        lastRightEye = a.x < b.x ? b : a;
+    }
+
+    if (lastFace.empty())
+        return false;
+    face = lastFace;
+    return true;
+#else
+    Q_UNUSED(gray); Q_UNUSED(window); Q_UNUSED(minSize); Q_UNUSED(maxSize); Q_UNUSED(face);
+    return false;
+#endif
+}
+
+/**
+ * @brief DnnFaceBackend::findEyes : the eye landmarks of the face, as boxes a third of the eye distance wide
+ * @param gray : 8 bit luminance image
+ * @param face : face returned by the last findFace()
+ * @param leftEye : receives the left eye
+ * @param rightEye : receives the right eye
+ * @return true if the landmarks belong to this face
+ */
+bool DnnFaceBackend::findEyes(const cv::Mat &gray, const cv::Rect &face, cv::Rect2f &leftEye, cv::Rect2f &rightEye) {
+    Q_UNUSED(gray);
+    if (lastFace.empty() || face != lastFace)
+        return false;
+
+    float side = float(cv::norm(lastRightEye - lastLeftEye)) / 3.0f;
+    if (side <= 0.0f)
+        return false;
+
+    leftEye = cv::Rect2f(lastLeftEye.x - side / 2.0f, lastLeftEye.y - side / 2.0f, side, side);
+    rightEye = cv::Rect2f(lastRightEye.x - side / 2.0f, lastRightEye.y - side / 2.0f, side, side);
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef DNNFACEBACKEND_H
+#define DNNFACEBACKEND_H
+
+#include <opencv2/core/version.hpp>
+#include <opencv2/objdetect.hpp>
+#include "facedetectorbackend.h"
+
+// cv::FaceDetectorYN arrived in OpenCV 4.5.4, older builds report the backend as not ready
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && (CV_VERSION_MINOR > 5 || (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 4)))
+#define HAVE_FACE_DETECTOR_YN
+#endif
+
+/**
+ * @brief The DnnFaceBackend class : YuNet face detector, one network run gives the face box and its eye landmarks
+ */
+class DnnFaceBackend : public FaceDetectorBackend
+{
+public:
+    explicit DnnFaceBackend(const QString &model);
+
+    Kind kind() const override;
+    bool isReady() const override;
+
+    bool findFace(const cv::Mat &gray, const cv::Rect &window, const cv::Size &minSize, const cv::Size &maxSize, cv::Rect &face) override;
+    bool providesEyes() const override;
+    bool findEyes(const cv::Mat &gray, const cv::Rect &face, cv::Rect2f &leftEye, cv::Rect2f &rightEye) override;
+
+private:
+#ifdef HAVE_FACE_DETECTOR_YN
+    cv::Ptr<cv::FaceDetectorYN> detector;
+#endif
+    cv::Mat color;
+    cv::Mat detections;
+
+    // landmarks of the last face found, handed out by findEyes()
+    cv::Rect lastFace;
+    cv::Point2f lastLeftEye, lastRightEye;
+};
+
+#endif // DNNFACEBACKEND_H
@@ -0,0 +1,170 @@
+#include "eyeflowtracker.h"
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+#include <algorithm>
+
+static const cv::Size flowWindow(11, 11);
+static const int flowLevels = 2;
+static const int maxPointsPerEye = 12;
+static const int minPointsPerEye = 4;
+static const float maxFlowError = 30.0f;
+
+/**
+ * @brief EyeFlowTracker::reset : forget the current track, the next frame needs a cascade detection
+ */
+void EyeFlowTracker::reset() {
+    tracking = false;
+    confidence = 0.0f;
+    points.clear();
+}
+
+/**
+ * @brief EyeFlowTracker::isTracking
+ * @return true if the eyes can be followed in the next frame
+ */
+bool EyeFlowTracker::isTracking() const {
+    return tracking;
+}
+
+/**
+ * @brief EyeFlowTracker::seed : start a new track from eyes found by the cascade
+ * @param gray : the frame the eyes were found in
+ * @param leftEye
+ * @param rightEye
+ * @return false if the eyes have too little texture to be tracked
+ */
+bool EyeFlowTracker::seed(const cv::Mat &gray, const cv::Rect2f &leftEye, const cv::Rect2f &rightEye) {
+    reset();
+
+    if (!collectFeatures(gray, leftEye))
+        return false;
+    leftCount = leftSeeded = int(points.size());
+
+    if (!collectFeatures(gray, rightEye))
+        return false;
+    rightSeeded = int(points.size()) - leftCount;
+
+    cv::buildOpticalFlowPyramid(gray, previousPyramid, flowWindow, flowLevels);
+    left = leftEye;
+    right = rightEye;
+    confidence = 1.0f;
+    tracking = true;
+    return true;
+}
+
+/**
+ * @brief EyeFlowTracker::collectFeatures : add the strongest corners inside an eye to the tracked points
+ * @param gray
+ * @param eye
+ * @return false if not enough corners were found
+ */
+bool EyeFlowTracker::collectFeatures(const cv::Mat &gray, const cv::Rect2f &eye) {
+    cv::Rect area = cv::Rect(eye) & cv::Rect(0, 0, gray.cols, gray.rows);
+    if (area.empty())
+        return false;
+
+    std::vector<cv::Point2f> corners;
+    cv::goodFeaturesToTrack(gray(area), corners, maxPointsPerEye, 0.01, 2.0);
+    if (int(corners.size()) < minPointsPerEye)
+        return false;
+
+    for (const cv::Point2f &corner : corners)
+        points.push_back(corner + cv::Point2f(float(area.x), float(area.y)));
+    return true;
+}
+
+/**
+ * @brief EyeFlowTracker::track : follow the eyes into a new frame
+ * @param gray : the new frame, same size as the seeded one
+ * @param leftEye : receives the sub-pixel left eye rect
+ * @param rightEye : receives the sub-pixel right eye rect
+ * @return false if the flow confidence dropped too low, the cascades have to find the eyes again
+ */
+bool EyeFlowTracker::track(const cv::Mat &gray, cv::Rect2f &leftEye, cv::Rect2f &rightEye) {
+    if (!tracking)
+        return false;
+
+    //The pyramid of this frame is kept as the previous one for the next frame, it is only built once
+    cv::buildOpticalFlowPyramid(gray, pyramid, flowWindow, flowLevels);
+    cv::calcOpticalFlowPyrLK(previousPyramid, pyramid, points, nextPoints, status, error, flowWindow, flowLevels);
+    std::swap(previousPyramid, pyramid);
+
+    int rightBegin = leftCount;
+    if (!moveEye(0, rightBegin, leftSeeded, left) || !moveEye(rightBegin, int(points.size()), rightSeeded, right)) {
+        reset();
+        return false;
+    }
+
+    //keep only the points that were tracked, for the next frame
+    int kept = 0;
+    leftCount = 0;
+    for (int i = 0; i < int(points.size()); i++) {
+        if (!status[i])
+            continue;
+        points[kept++] = nextPoints[i];
+        if (i < rightBegin)
+            leftCount++;
+    }
+    points.resize(kept);
+
+    leftEye = left;
+    rightEye = right;
+    return true;
+}
+
+/**
+ * @brief EyeFlowTracker::moveEye : shift an eye by the median flow of its points
+ * @param begin : first point of the eye
+ * @param end : one past the last point of the eye
+ * @param seeded : number of points the eye started with
+ * @param eye : the rect to move
+ * @return false if too few points of the eye survived
+ */
+bool EyeFlowTracker::moveEye(int begin, int end, int seeded, cv::Rect2f &eye) {
+    displacement.clear();
+    for (int i = begin; i < end; i++) {
+        if (status[i] && error[i] > maxFlowError)
+            status[i] = 0;
+        if (status[i])
+            displacement.push_back(nextPoints[i].x - points[i].x);
+    }
+
+    int tracked = int(displacement.size());
+    float eyeConfidence = seeded ? float(tracked) / seeded : 0.0f;
+    confidence = begin == 0 ? eyeConfidence : std::min(confidence, eyeConfidence);
+    if (tracked < minPointsPerEye || eyeConfidence < minConfidence)
+        return false;
+
+    //median is robust to the few points that slide along the eyelids
+    auto median = displacement.begin() + tracked / 2;
+    std::nth_element(displacement.begin(), median, displacement.end());
+    float dx = *median;
+
+    displacement.clear();
+    for (int i = begin; i < end; i++)
+        if (status[i])
+            displacement.push_back(nextPoints[i].y - points[i].y);
+    median = displacement.begin() + tracked / 2;
+    std::nth_element(displacement.begin(), median, displacement.end());
+    float dy = *median;
+
+    eye.x += dx;
+    eye.y += dy;
+    return true;
+}
+
+/**
+ * @brief EyeFlowTracker::setMinConfidence
+ * @param confidence : fraction of the seeded points of each eye that must still be tracked
+ */
+void EyeFlowTracker::setMinConfidence(float confidence) {
+    minConfidence = confidence;
+}
+
+/**
+ * @brief EyeFlowTracker::getConfidence
+ * @return fraction of the seeded points still tracked, for the worst eye
+ */
+float EyeFlowTracker::getConfidence() const {
+    return confidence;
+}
@@ -0,0 +1,45 @@
+#ifndef EYEFLOWTRACKER_H
+#define EYEFLOWTRACKER_H
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief The EyeFlowTracker class : follows both eyes between cascade detections with pyramidal Lucas-Kanade flow.
+ * Seeded with feature points from a successful eye detection, every later frame only costs a small flow update.
+ */
+class EyeFlowTracker
+{
+public:
+    void reset();
+    bool isTracking() const;
+
+    bool seed(const cv::Mat &gray, const cv::Rect2f &leftEye, const cv::Rect2f &rightEye);
+    bool track(const cv::Mat &gray, cv::Rect2f &leftEye, cv::Rect2f &rightEye);
+
+    void setMinConfidence(float confidence);
+    float getConfidence() const;
+
+private:
+    bool collectFeatures(const cv::Mat &gray, const cv::Rect2f &eye);
+    bool moveEye(int begin, int end, int seeded, cv::Rect2f &eye);
+
+private:
+    std::vector<cv::Mat> previousPyramid;
+    std::vector<cv::Mat> pyramid;
+    std::vector<cv::Point2f> points;
+    std::vector<cv::Point2f> nextPoints;
+    std::vector<uchar> status;
+    std::vector<float> error;
+    std::vector<float> displacement;
+
+    cv::Rect2f left, right;
+    int leftCount = 0;              // points[0, leftCount) belong to the left eye, the rest to the right eye
+    int leftSeeded = 0, rightSeeded = 0;
+
+    float minConfidence = 0.6f;
+    float confidence = 0.0f;
+    bool tracking = false;
+};
+
+#endif // EYEFLOWTRACKER_H
@@ -0,0 +1,50 @@
+#include "facedetectorbackend.h"
+#include "cascadebackend.h"
+#include "dnnfacebackend.h"
+
+/**
+ * @brief FaceDetectorBackend::create
+ * @param kind
+ * @param model : face model for Lbp (cascade xml) and Dnn (YuNet onnx), resource or file path. Haar ignores it.
+ * @return a new backend, check isReady()
+ */
+FaceDetectorBackend *FaceDetectorBackend::create(Kind kind, const QString &model) {
+    switch (kind) {
+    case Lbp:
+        return new CascadeBackend(Lbp, model, ":/haarcascade_eye.xml");
+    case Dnn:
+        return new DnnFaceBackend(model);
+    case Haar:
+    default:
+        return new CascadeBackend(Haar, ":/haarcascade_frontalface_alt.xml", ":/haarcascade_eye.xml");
+    }
+}
+
+/**
+ * @brief FaceDetectorBackend::kindName
+ * @param kind
+ * @return "haar", "lbp" or "dnn"
+ */
+const char *FaceDetectorBackend::kindName(Kind kind) {
+    switch (kind) {
+    case Lbp: return "lbp";
+    case Dnn: return "dnn";
+    default: return "haar";
+    }
+}
+
+/**
+ * @brief FaceDetectorBackend::parseKind
+ * @param name : "haar", "lbp" or "dnn"
+ * @param kind : receives the backend
+ * @return false if the name is unknown
+ */
+bool FaceDetectorBackend::parseKind(const QString &name, Kind &kind) {
+    for (Kind candidate : {Haar, Lbp, Dnn}) {
+        if (name.compare(kindName(candidate), Qt::CaseInsensitive) == 0) {
+            kind = candidate;
+            return true;
+        }
+    }
+    return false;
+}
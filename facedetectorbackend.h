@@ -0,0 +1,43 @@
+#ifndef FACEDETECTORBACKEND_H
+#define FACEDETECTORBACKEND_H
+
+#include <QString>
+#include <opencv2/core.hpp>
+
+/**
+ * @brief The FaceDetectorBackend class : what finds the face and the eyes in a gray image.
+ * DetectionWorker decides where to search (tracking window, size band) and when the eyes are followed by optical flow,
+ * the backend only runs the detector.
+ */
+class FaceDetectorBackend
+{
+public:
+    enum Kind {
+        Haar,   // haarcascade_frontalface_alt + haarcascade_eye, from the resources
+        Lbp,    // LBP face cascade (e.g. lbpcascade_frontalface_improved.xml) + haarcascade_eye
+        Dnn     // YuNet face detector (cv::FaceDetectorYN), eye landmarks straight from the network
+    };
+
+    virtual ~FaceDetectorBackend() {}
+
+    static FaceDetectorBackend *create(Kind kind, const QString &model = QString());
+    static const char *kindName(Kind kind);
+    static bool parseKind(const QString &name, Kind &kind);
+
+    virtual Kind kind() const = 0;
+    virtual bool isReady() const = 0;
+    virtual bool loadedFromCache() const { return false; }
+    // true if findEyes() reads the eyes off the detection itself (landmarks) instead of searching the face for them
+    virtual bool providesEyes() const { return false; }
+    // factor between two searched face sizes, detectors without an image pyramid ignore it
+    virtual void setScaleStep(double) {}
+    // how many threads one search may use, 0 for one per core; detectors that manage their own threads ignore it
+    virtual void setThreadCount(int) {}
+
+    // biggest face inside window, between minSize and maxSize (empty sizes: no limit)
+    virtual bool findFace(const cv::Mat &gray, const cv::Rect &window, const cv::Size &minSize, const cv::Size &maxSize, cv::Rect &face) = 0;
+    // the eyes of a face found by findFace() on the same image, leftEye is the one on the left of the image
+    virtual bool findEyes(const cv::Mat &gray, const cv::Rect &face, cv::Rect2f &leftEye, cv::Rect2f &rightEye) = 0;
+};
+
+#endif // FACEDETECTORBACKEND_H
@@ -1,174 +1,215 @@
 #include "facefeaturedetector.h"
+#include <QDebug>
 
 /**
- * @brief FaceFeatureDetector::FaceFeatureDetector : constuctor
+ * @brief FaceFeatureDetector::FaceFeatureDetector : constuctor, starts the detection thread
+ * @param imgWidth : width of the upright image the detection runs on
+ * @param imgHeight : height of the upright image the detection runs on
  * @param parent
  */
 FaceFeatureDetector::FaceFeatureDetector(int imgWidth, int imgHeight, QObject *parent) :
     QObject(parent),
-    imgSize(QSize(imgWidth, imgHeight))
+    imgSize(QSize(imgWidth, imgHeight)),
+    createdNs(monotonicNs())
 {
-
-    //Load face cascade classifier
-    QFile xmlFace(":/haarcascade_frontalface_alt.xml");
-    if (xmlFace.open(QFile::ReadOnly | QFile::Text)) {
-        QTemporaryFile temp;
-        if (temp.open()) {
-            temp.write(xmlFace.readAll());
-            temp.close();
-            if (faceClassifier.load(temp.fileName().toStdString()))
-                qDebug() << "Successfully loaded Face classifier!";
-            else
-                qDebug() << "Could not load Face classifier.";
-        } else
-            qDebug() << "Can't open Face temp file.";
-    }
-
-    //Load eye cascade classifier
-    QFile xmlEye(":/haarcascade_eye.xml");
-    if (xmlEye.open(QFile::ReadOnly | QFile::Text)) {
-        QTemporaryFile temp;
-        if (temp.open()) {
-            temp.write(xmlEye.readAll());
-            temp.close();
-            if (eyeClassifier.load(temp.fileName().toStdString()))
-                qDebug() << "Successfully loaded Eye classifier!";
-            else
-                qDebug() << "Could not load Eye classifier.";
-        } else
-            qDebug() << "Can't open Eye temp file.";
-    }
+    //The worker owns the classifiers and runs the cascades away from the GUI/render thread
+    worker = new DetectionWorker(imgSize, poses);
+    worker->moveToThread(&detectionThread);
+    connect(&detectionThread, &QThread::started, worker, &DetectionWorker::run);
+    connect(&detectionThread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(worker, &DetectionWorker::frameProcessed, this, &FaceFeatureDetector::frameProcessed); //queued to this thread
+    coldStartConnection = connect(this, &FaceFeatureDetector::headPoseAvailable, this, &FaceFeatureDetector::firstPoseAvailable);
+
+    detectionThread.setObjectName("FaceDetection");
+    detectionThread.start();
+
+    //Stats are printed from here, the detection loop itself never logs
+    statsTimer.start(5000, this);
 }
 
 /**
- * @brief FaceFeatureDetector::start : initialize the feature detector
- * @param qmlObj : to be able to interact with the QML side of the project
+ * @brief FaceFeatureDetector::frameProcessed : poses were published since the last wakeup, coalesced by the worker
  */
-void FaceFeatureDetector::start(QObject *qmlObj) {
-    qmlObject = qmlObj;
+void FaceFeatureDetector::frameProcessed() {
+    worker->acknowledgeFrameProcessed();
+    emit headPoseAvailable();
+}
 
-    //Connect the QML frameReady SIGNAL to our frameReady SLOT
-    connect(qmlObject, SIGNAL(frameReady(QVariant)), this, SLOT(frameReady(QVariant)));
+/**
+ * @brief FaceFeatureDetector::firstPoseAvailable : report the cold start, once
+ */
+void FaceFeatureDetector::firstPoseAvailable() {
+    disconnect(coldStartConnection);
+    coldStartMs = (monotonicNs() - createdNs) / 1e6;
+    qDebug().nospace() << "cold start: " << FaceDetectorBackend::kindName(worker->getDetector()) << " detector "
+                       << (worker->detectorLoadedFromCache() ? "loaded from the cache" : "loaded from the models") << " in "
+                       << worker->getDetectorLoadMs() << " ms, first frame processed after " << coldStartMs << " ms";
+}
 
-    grab(); //Do the first grab to test for faces and eyes
+/**
+ * @brief FaceFeatureDetector::getColdStartMs
+ * @return time from construction to the first processed frame, 0 until then
+ */
+double FaceFeatureDetector::getColdStartMs() const {
+    return coldStartMs;
 }
 
 /**
- * @brief FaceFeatureDetector::grab : call the function in QML
+ * @brief FaceFeatureDetector::~FaceFeatureDetector : destructor, stops the detection thread
  */
-void FaceFeatureDetector::grab() {
-    QMetaObject::invokeMethod(qmlObject, "grab");
+FaceFeatureDetector::~FaceFeatureDetector() {
+    stop();
+    worker->requestStop();
+    detectionThread.quit();
+    detectionThread.wait();
 }
 
 /**
- * @brief FaceFeatureDetector::frameReady:  extract frame from QML grab and process for faces and eyes
- * @param frameVariant
+ * @brief FaceFeatureDetector::start : start processing the frames of a source
+ * @param frameSource : camera or recorded frames
+ * @return true if the source started
  */
-void FaceFeatureDetector::frameReady(const QVariant &frameVariant) {
-    //extract image from grab
-    QQuickItemGrabResult *grab_result = qvariant_cast<QQuickItemGrabResult*>(frameVariant); //Cast from QVariant
-    QImage frame = grab_result->image(); //Get the QImage
-    grab_result->deleteLater(); //Release QQuickItemGrabResult
+bool FaceFeatureDetector::start(FrameSource *frameSource) {
+    stop();
+    source = frameSource;
+
+    //Direct connection: the source thread only hands the frame over, it never runs the cascades
+    connect(source, &FrameSource::frameAvailable, this, &FaceFeatureDetector::frameAvailable, Qt::DirectConnection);
 
-    //convert QImage to cv::Mat
-    cv::Mat img(frame.height(), frame.width(), CV_8UC4, (void *)frame.constBits(), frame.bytesPerLine());
-    cv::cvtColor(img, img, cv::COLOR_BGR2GRAY);
+    return source->start();
+}
 
-    face = QRect(0, 0, 0, 0);
-    rightEye = QRect(0, 0, 0, 0);
-    leftEye = QRect(0, 0, 0, 0);
+/**
+ * @brief FaceFeatureDetector::stop : stop the current frame source
+ */
+void FaceFeatureDetector::stop() {
+    if (!source)
+        return;
+    source->stop();
+    disconnect(source, nullptr, this, nullptr);
+    source = nullptr;
+}
 
-    //detecting faces and drawing:
-    qDebug() << "detecting... ";
-    std::vector<cv::Rect> cvfaces, cvfaceeyes;
-    faceClassifier.detectMultiScale(img, cvfaces, 1.1, 3, cv::CASCADE_DO_ROUGH_SEARCH | cv::CASCADE_FIND_BIGGEST_OBJECT); //magic
+/**
+ * @brief FaceFeatureDetector::frameAvailable : queue a new frame to the detection thread, runs on the source thread
+ * @param frame
+ */
+void FaceFeatureDetector::frameAvailable(const LumaFrame &frame) {
+    worker->enqueue(frame); //the frame is reference counted, safe to hand to the worker
+}
 
-    //process faces and eyes
-    if (cvfaces.size() >= 1) {
-        cv::Rect cvface = cvfaces[0];
-        face = QRect(cvface.x, cvface.y, cvface.width, cvface.height);
-        cv::Mat faceImg = img(cvface);
-        eyeClassifier.detectMultiScale(faceImg, cvfaceeyes, 1.1, 3, cv::CASCADE_DO_ROUGH_SEARCH); //more magic
+void FaceFeatureDetector::timerEvent(QTimerEvent *)
+{
+    logStats();
+}
 
-        if (cvfaceeyes.size() >= 2) {
-            std::sort(cvfaceeyes.begin(), cvfaceeyes.end(), [](const cv::Rect& a, const cv::Rect& b) {
-                return (a.y < b.y);
-            });
+/**
+ * @brief FaceFeatureDetector::setBackpressurePolicy : how frames are dropped when detection is slower than capture
+ * @param capacity : number of frames that can wait for the detector
+ * @param policy
+ */
+void FaceFeatureDetector::setBackpressurePolicy(int capacity, FrameQueue::BackpressurePolicy policy) {
+    worker->getQueue().setPolicy(capacity, policy);
+}
 
-            cv::Rect eye1 = cvfaceeyes[0];
-            cv::Rect eye2 = cvfaceeyes[1];
-            if (eye1.x < eye2.x){
-                leftEye = QRect(eye1.x + cvface.x, eye1.y + cvface.y, eye1.width, eye1.height);
-                rightEye = QRect(eye2.x + cvface.x, eye2.y + cvface.y, eye2.width, eye2.height);
-            } else {
-                leftEye = QRect(eye2.x + cvface.x, eye2.y + cvface.y, eye2.width, eye2.height);
-                rightEye = QRect(eye1.x + cvface.x, eye1.y + cvface.y, eye1.width, eye1.height);
-            }
-            calculateDistance();
+/**
+ * @brief FaceFeatureDetector::logStats : print the per stage latency and throughput, and the percentiles of the last 5 s
+ */
+void FaceFeatureDetector::logStats() {
+    auto print = [](const char *name, const StageStats &stats) {
+        qDebug().nospace() << name << ": " << stats.count() << " frames, "
+                           << stats.throughput() << " fps, avg " << stats.averageMs()
+                           << " ms, max " << stats.maxMs() << " ms";
+    };
+    print("capture", getCaptureStats());
+    print("convert", getConvertStats());
+    print("motion gate", worker->getMotionGateStats());
+    print("detect", getDetectStats());
+    print("face search (tracked)", worker->getRoiSearchStats());
+    print("face search (full frame)", worker->getFullSearchStats());
+    print("eyes (detector)", worker->getEyeCascadeStats());
+    print("eyes (optical flow)", worker->getEyeFlowStats());
+
+    const DetectionGovernor &governor = worker->getGovernor();
+    qDebug().nospace() << "governor: resolution " << governor.currentResolution() << ", scale step "
+                       << governor.currentScaleStep() << ", " << governor.currentRate() << " detections/s, "
+                       << worker->getRateSkippedCount() << " frames skipped";
+
+    if (HotPathTrace::isEnabled()) {
+        for (int stage = 0; stage < HotPathTrace::StageCount; stage++) {
+            HotPathTrace::Summary summary = HotPathTrace::summarize(HotPathTrace::Stage(stage), 5000000000LL);
+            if (summary.count)
+                qDebug().nospace() << HotPathTrace::stageName(HotPathTrace::Stage(stage)) << ": " << summary.count
+                                   << " samples, p50 " << summary.p50Ms << " ms, p95 " << summary.p95Ms
+                                   << " ms, p99 " << summary.p99Ms << " ms";
         }
     }
-
-    qDebug() << "face: " << face;
-    qDebug() << "right eye: " << rightEye;
-    qDebug() << "left eye: " << leftEye;
-
-    grab(); //Do the next frame grab
+    qDebug().nospace() << "frames captured: " << getCapturedCount() << ", processed: " << getProcessedCount()
+                       << ", gated: " << worker->getGatedCount() << ", dropped: " << getDroppedCount();
 }
 
 /**
- * @brief FaceFeatureDetector::calculateDistance: Rough estimation of the distance between the camera and the face
+ * @brief FaceFeatureDetector::latestHeadPose : lock-free, the result of the most recently processed frame.
+ * Only one thread (the renderer) may call this.
+ * @return a consistent copy of the pose
  */
-void FaceFeatureDetector::calculateDistance() {
-
-    /*
-     * Estimation model:
-     * l = 1470 / d
-     *
-     * l : distance between face and camera
-     * d : distance between both eyes
-     */
+HeadPose FaceFeatureDetector::latestHeadPose() {
+    return poses.read();
+}
 
-    distanceFromCamera = 1470.0f / (rightEye.x() - leftEye.x());
-//    qDebug() << "Distance from cam in cm: " << distanceFromCamera;
+/**
+ * @brief FaceFeatureDetector::setTrackingSettings : change how the face is searched, applied on the detection thread
+ * @param settings
+ */
+void FaceFeatureDetector::setTrackingSettings(const TrackingSettings &settings) {
+    worker->requestTrackingSettings(settings);
+}
 
+/**
+ * @brief FaceFeatureDetector::getCapturedCount
+ * @return number of frames delivered by the frame source
+ */
+quint64 FaceFeatureDetector::getCapturedCount() const {
+    return worker->getQueue().pushedCount();
 }
 
 /**
- * @brief FaceFeatureDetector::getImageSize
- * @return : the size of the img in qml
+ * @brief FaceFeatureDetector::getProcessedCount
+ * @return number of frames that went through detection
  */
-QSize FaceFeatureDetector::getImageSize() {
-    return imgSize;
+quint64 FaceFeatureDetector::getProcessedCount() const {
+    return worker->getDetectStats().count();
 }
 
 /**
- * @brief FaceFeatureDetector::getFaceRect
- * @return : return the face info
+ * @brief FaceFeatureDetector::getDroppedCount
+ * @return number of frames dropped by the backpressure policy
  */
-QRect FaceFeatureDetector::getFaceRect() {
-    return face;
+quint64 FaceFeatureDetector::getDroppedCount() const {
+    return worker->getQueue().droppedCount();
 }
 
 /**
- * @brief FaceFeatureDetector::getRightEyeRect :
- * @return : return the right rye info
+ * @brief FaceFeatureDetector::getCaptureStats
+ * @return timing of the frame source
  */
-QRect FaceFeatureDetector::getRightEyeRect() {
-    return rightEye;
+const StageStats &FaceFeatureDetector::getCaptureStats() const {
+    static const StageStats none;
+    return source ? source->getCaptureStats() : none;
 }
 
 /**
- * @brief FaceFeatureDetector::getLeftEyeRect :
- * @return : return the left eye info
+ * @brief FaceFeatureDetector::getConvertStats
+ * @return timing of the rotation and scaling on the detection thread
  */
-QRect FaceFeatureDetector::getLeftEyeRect() {
-    return leftEye;
+const StageStats &FaceFeatureDetector::getConvertStats() const {
+    return worker->getConvertStats();
 }
 
 /**
- * @brief FaceFeatureDetector::getDistanceFromCamera
- * @return distance from camera
+ * @brief FaceFeatureDetector::getDetectStats
+ * @return timing of the cascades on the detection thread
  */
-float FaceFeatureDetector::getDistanceFromCamera() {
-    return distanceFromCamera;
+const StageStats &FaceFeatureDetector::getDetectStats() const {
+    return worker->getDetectStats();
 }
@@ -1,40 +1,65 @@
 #ifndef FACEFEATUREDETECTOR_H
 #define FACEFEATUREDETECTOR_H
 
-#include <QtQuick>
-#include <opencv2/opencv.hpp>
+#include <QObject>
+#include <QThread>
+#include <QBasicTimer>
+#include "detectionworker.h"
+#include "framesource.h"
+#include "headpose.h"
+#include "stagestats.h"
+#include "triplebuffer.h"
 
 class FaceFeatureDetector : public QObject
 {
     Q_OBJECT
 public:
     explicit FaceFeatureDetector(int imgWidth, int imgHeight, QObject *parent = nullptr);
-    void start(QObject *qmlObj);
-    void grab();
-    QSize getImageSize();
-    QRect getFaceRect();
-    QRect getRightEyeRect();
-    QRect getLeftEyeRect();
-    float getDistanceFromCamera();
+    ~FaceFeatureDetector() override;
+    bool start(FrameSource *frameSource);
+    void stop();
+    HeadPose latestHeadPose();
+    void setBackpressurePolicy(int capacity, FrameQueue::BackpressurePolicy policy);
+    void setTrackingSettings(const TrackingSettings &settings);
 
-private:
-    void calculateDistance();
+    quint64 getCapturedCount() const;
+    quint64 getProcessedCount() const;
+    quint64 getDroppedCount() const;
+    double getColdStartMs() const;
+
+    const StageStats &getCaptureStats() const;
+    const StageStats &getConvertStats() const;
+    const StageStats &getDetectStats() const;
+
+signals:
+    void headPoseAvailable();
+
+protected:
+    void timerEvent(QTimerEvent *e) override;
 
 private slots:
-    void frameReady(const QVariant &frameVariant);
+    void frameAvailable(const LumaFrame &frame);
+    void frameProcessed();
+    void firstPoseAvailable();
+
+private:
+    void logStats();
 
 private:
     QSize imgSize;
 
-    QObject *qmlObject;
+    FrameSource *source = nullptr;
+
+    TripleBuffer<HeadPose> poses;
+
+    QThread detectionThread;
+    DetectionWorker *worker;
 
-    cv::CascadeClassifier faceClassifier;
-    cv::CascadeClassifier eyeClassifier;
+    QBasicTimer statsTimer;
 
-    QRect face = QRect(0, 0, 0, 0);
-    QRect rightEye = QRect(0, 0, 0, 0);
-    QRect leftEye = QRect(0, 0, 0, 0);
-    float distanceFromCamera;
+    qint64 createdNs;
+    double coldStartMs = 0.0;
+    QMetaObject::Connection coldStartConnection;
 };
 
 #endif // FACEFEATUREDETECTOR_H
@@ -0,0 +1,77 @@
+#include "fileframesource.h"
+#include "headpose.h"
+#include <QDebug>
+#include <opencv2/imgproc.hpp>
+
+/**
+ * @brief FileFrameSource::FileFrameSource : constructor, opens the file
+ * @param path : video file or printf style image sequence pattern
+ * @param fps : rate at which start() emits the frames
+ * @param orientation : anti-clockwise rotation of the recorded frames
+ * @param parent
+ */
+FileFrameSource::FileFrameSource(const QString &path, double fps, int orientation, QObject *parent) :
+    FrameSource(parent),
+    capture(path.toStdString()),
+    fps(fps),
+    orientation(orientation)
+{
+    if (!capture.isOpened())
+        qDebug() << "Can't open" << path;
+}
+
+/**
+ * @brief FileFrameSource::isOpen
+ * @return true if the file could be opened
+ */
+bool FileFrameSource::isOpen() const {
+    return capture.isOpened();
+}
+
+/**
+ * @brief FileFrameSource::start : emit frameAvailable at the configured rate until the end of the file
+ * @return true if the file is open
+ */
+bool FileFrameSource::start() {
+    if (!isOpen())
+        return false;
+    playbackTimer.start(qMax(1, int(1000.0 / fps)), Qt::PreciseTimer, this);
+    return true;
+}
+
+/**
+ * @brief FileFrameSource::stop
+ */
+void FileFrameSource::stop() {
+    playbackTimer.stop();
+}
+
+void FileFrameSource::timerEvent(QTimerEvent *)
+{
+    LumaFrame frame;
+    if (readFrame(frame))
+        emit frameAvailable(frame);
+    else
+        stop();
+}
+
+/**
+ * @brief FileFrameSource::readFrame : synchronously decode the next frame, for callers that drive the detector themselves
+ * @param frame : receives the gray image
+ * @return false at the end of the file
+ */
+bool FileFrameSource::readFrame(LumaFrame &frame) {
+    ScopedStageTimer timer(captureStats, HotPathTrace::Capture);
+
+    if (!capture.read(decoded) || decoded.empty())
+        return false;
+
+    frame.timestampNs = monotonicNs();
+    if (decoded.channels() == 1)
+        frame.gray = decoded.clone();
+    else
+        cv::cvtColor(decoded, frame.gray, decoded.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    frame.orientation = orientation;
+    frame.sequence = ++frameCount;
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef FILEFRAMESOURCE_H
+#define FILEFRAMESOURCE_H
+
+#include <QBasicTimer>
+#include <opencv2/videoio.hpp>
+#include "framesource.h"
+
+/**
+ * @brief The FileFrameSource class : frames from a recorded video or an image sequence (e.g. "frames/%04d.png"),
+ * so the detector can run without a camera.
+ */
+class FileFrameSource : public FrameSource
+{
+    Q_OBJECT
+public:
+    explicit FileFrameSource(const QString &path, double fps = 30.0, int orientation = 0, QObject *parent = nullptr);
+
+    bool start() override;
+    void stop() override;
+
+    bool isOpen() const;
+    bool readFrame(LumaFrame &frame);
+
+protected:
+    void timerEvent(QTimerEvent *e) override;
+
+private:
+    cv::VideoCapture capture;
+    cv::Mat decoded;
+    QBasicTimer playbackTimer;
+    double fps;
+    int orientation;
+    quint64 frameCount = 0;
+};
+
+#endif // FILEFRAMESOURCE_H
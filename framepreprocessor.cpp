@@ -0,0 +1,143 @@
+#include "framepreprocessor.h"
+#include "lumakernels.h"
+#include <opencv2/imgproc.hpp>
+#include <cstring>
+
+/**
+ * @brief FramePreprocessor::setEqualizeHistogram
+ * @param equalize : stretch the contrast of every frame before detection
+ */
+void FramePreprocessor::setEqualizeHistogram(bool equalize) {
+    equalizeHistogram = equalize;
+}
+
+/**
+ * @brief FramePreprocessor::process : luma, downscale, equalize and rotate a frame
+ * @param frame : gray or BGRA frame from a FrameSource
+ * @param uprightSize : size of the image the cascades run on
+ * @return the upright image, valid until the next call
+ */
+const cv::Mat &FramePreprocessor::process(const LumaFrame &frame, const cv::Size &uprightSize) {
+    int rotation = ((frame.orientation % 360) + 360) % 360;
+    bool quarterTurn = rotation == 90 || rotation == 270;
+    cv::Size size = quarterTurn ? cv::Size(uprightSize.height, uprightSize.width) : uprightSize;
+
+    bool histogramReady = false;
+    const cv::Mat *img = toLuma(frame, size, histogramReady);
+
+    if (img->size() != size) {
+        cv::resize(*img, resized, size, 0, 0, cv::INTER_AREA);
+        img = &resized;
+        histogramReady = false;
+    }
+
+    if (equalizeHistogram) {
+        equalize(*img, histogramReady);
+        img = &equalized;
+    }
+
+    switch (rotation) {
+    case 90:
+        cv::rotate(*img, upright, cv::ROTATE_90_COUNTERCLOCKWISE);
+        return upright;
+    case 180:
+        cv::rotate(*img, upright, cv::ROTATE_180);
+        return upright;
+    case 270:
+        cv::rotate(*img, upright, cv::ROTATE_90_CLOCKWISE);
+        return upright;
+    default:
+        return *img;
+    }
+}
+
+/**
+ * @brief FramePreprocessor::toLuma : the luminance of the frame, already downscaled when it is larger than the size.
+ * Exact 2x and 4x multiples take the box kernels, other ratios the area kernels, only upscales are left to cv::resize.
+ * @param frame
+ * @param size : wanted size before rotation
+ * @param histogramReady : set when the histogram of the returned image was gathered on the way
+ * @return the luminance image
+ */
+const cv::Mat *FramePreprocessor::toLuma(const LumaFrame &frame, const cv::Size &size, bool &histogramReady) {
+    const bool fromBgra = !frame.bgra.empty();
+    const cv::Mat &src = fromBgra ? frame.bgra : frame.gray;
+
+    int factor = size.width > 0 ? src.cols / size.width : 1;
+    if ((factor != 2 && factor != 4) || src.cols != size.width * factor || src.rows != size.height * factor)
+        factor = 1;
+    const bool area = factor == 1 && src.size() != size && src.cols >= size.width && src.rows >= size.height;
+
+    if (!fromBgra && factor == 1 && !area)
+        return &frame.gray; //already luma at the right size (or smaller, resized afterwards), used in place
+
+    if (area)
+        luma.create(size, CV_8UC1);
+    else
+        luma.create(src.rows / factor, src.cols / factor, CV_8UC1);
+    if (equalizeHistogram)
+        memset(histogram, 0, sizeof(histogram));
+    uint32_t *counts = equalizeHistogram ? histogram : nullptr;
+
+    if (area) {
+        if (areaColumns.srcSize != src.cols || areaColumns.dstSize != size.width) {
+            areaColumns.build(src.cols, size.width);
+            areaBuffer.resize(2 * size_t(size.width));
+        }
+        if (areaRows.srcSize != src.rows || areaRows.dstSize != size.height)
+            areaRows.build(src.rows, size.height);
+
+        if (fromBgra)
+            LumaKernels::areaBgraToLuma(src.data, int(src.step), luma.data, int(luma.step), areaColumns, areaRows, areaBuffer.data(), counts);
+        else
+            LumaKernels::areaDownscaleLuma(src.data, int(src.step), luma.data, int(luma.step), areaColumns, areaRows, areaBuffer.data(), counts);
+    } else if (fromBgra) {
+        LumaKernels::bgraToLuma(src.data, int(src.step), luma.data, int(luma.step), luma.cols, luma.rows, factor, counts);
+    } else {
+        LumaKernels::downscaleLuma(src.data, int(src.step), luma.data, int(luma.step), luma.cols, luma.rows, factor, counts);
+    }
+
+    histogramReady = equalizeHistogram;
+    return &luma;
+}
+
+/**
+ * @brief FramePreprocessor::equalize : histogram equalization through a lookup table, same mapping as cv::equalizeHist
+ * @param img
+ * @param histogramReady : the histogram of img was already gathered by a fused kernel
+ */
+void FramePreprocessor::equalize(const cv::Mat &img, bool histogramReady) {
+    if (!histogramReady) {
+        memset(histogram, 0, sizeof(histogram));
+        for (int y = 0; y < img.rows; y++) {
+            const uchar *row = img.ptr<uchar>(y);
+            for (int x = 0; x < img.cols; x++)
+                histogram[row[x]]++;
+        }
+    }
+
+    uint32_t total = uint32_t(img.total());
+    int first = 0;
+    while (first < 255 && histogram[first] == 0)
+        first++;
+
+    if (histogram[first] == total) {
+        memset(lookup, first, sizeof(lookup));
+    } else {
+        float scale = 255.0f / (total - histogram[first]);
+        uint32_t sum = 0;
+        memset(lookup, 0, first + 1);
+        for (int i = first + 1; i < 256; i++) {
+            sum += histogram[i];
+            lookup[i] = cv::saturate_cast<uchar>(sum * scale);
+        }
+    }
+
+    equalized.create(img.size(), CV_8UC1);
+    for (int y = 0; y < img.rows; y++) {
+        const uchar *in = img.ptr<uchar>(y);
+        uchar *out = equalized.ptr<uchar>(y);
+        for (int x = 0; x < img.cols; x++)
+            out[x] = lookup[in[x]];
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef FRAMEPREPROCESSOR_H
+#define FRAMEPREPROCESSOR_H
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <vector>
+#include "lumaframe.h"
+#include "lumakernels.h"
+
+/**
+ * @brief The FramePreprocessor class : turns a camera frame into the upright 8 bit image the cascades run on.
+ * Frames go through the fused LumaKernels pass (luma + downscale + histogram), the box kernels for 2x and 4x
+ * and the area kernels for any other downscale. All buffers are reused so nothing is allocated once the frame size
+ * is stable.
+ */
+class FramePreprocessor
+{
+public:
+    void setEqualizeHistogram(bool equalize);
+
+    const cv::Mat &process(const LumaFrame &frame, const cv::Size &uprightSize);
+
+private:
+    const cv::Mat *toLuma(const LumaFrame &frame, const cv::Size &size, bool &histogramReady);
+    void equalize(const cv::Mat &img, bool histogramReady);
+
+private:
+    bool equalizeHistogram = false;
+    uint32_t histogram[256];
+    uchar lookup[256];
+
+    LumaKernels::AreaAxis areaColumns, areaRows;
+    std::vector<uint32_t> areaBuffer;
+
+    cv::Mat luma;
+    cv::Mat resized;
+    cv::Mat equalized;
+    cv::Mat upright;
+};
+
+#endif // FRAMEPREPROCESSOR_H
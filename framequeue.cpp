@@ -0,0 +1,120 @@
+#include "framequeue.h"
+
+/**
+ * @brief FrameQueue::FrameQueue : constructor
+ * @param capacity : number of frames that can wait while one is being detected
+ * @param policy : what to do with a frame when the queue is full
+ */
+FrameQueue::FrameQueue(int capacity, BackpressurePolicy policy)
+{
+    setPolicy(capacity, policy);
+}
+
+/**
+ * @brief FrameQueue::setPolicy : change the capacity and backpressure policy, drops the waiting frames
+ * @param capacity : ignored for LatestOnly which always has one slot
+ * @param policy
+ */
+void FrameQueue::setPolicy(int capacity, BackpressurePolicy policy) {
+    QMutexLocker locker(&mutex);
+    this->policy = policy;
+    dropped += size;
+    frames.assign(policy == LatestOnly ? 1 : qMax(1, capacity), LumaFrame());
+    head = 0;
+    size = 0;
+}
+
+/**
+ * @brief FrameQueue::getPolicy
+ * @return the backpressure policy
+ */
+FrameQueue::BackpressurePolicy FrameQueue::getPolicy() const {
+    QMutexLocker locker(&mutex);
+    return policy;
+}
+
+/**
+ * @brief FrameQueue::push : add a frame, never blocks on the consumer
+ * @param frame
+ */
+void FrameQueue::push(const LumaFrame &frame) {
+    QMutexLocker locker(&mutex);
+    pushed.fetch_add(1, std::memory_order_relaxed);
+
+    int capacity = int(frames.size());
+    if (size == capacity) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        if (policy == DropNewest)
+            return;
+
+        //LatestOnly and DropOldest: the oldest frame gives its slot to the new one
+        frames[head] = LumaFrame();
+        head = (head + 1) % capacity;
+        size--;
+    }
+
+    frames[(head + size) % capacity] = frame;
+    size++;
+    frameReady.wakeOne();
+}
+
+/**
+ * @brief FrameQueue::pop : take the oldest waiting frame
+ * @param frame : receives the frame
+ * @return false if no frame was waiting
+ */
+bool FrameQueue::pop(LumaFrame &frame) {
+    QMutexLocker locker(&mutex);
+    if (size == 0)
+        return false;
+
+    frame = frames[head];
+    frames[head] = LumaFrame(); //release the camera buffer as soon as possible
+    head = (head + 1) % int(frames.size());
+    size--;
+    return true;
+}
+
+/**
+ * @brief FrameQueue::waitPop : take the oldest waiting frame, sleeping until one arrives
+ * @param frame : receives the frame
+ * @return false once the queue was interrupted
+ */
+bool FrameQueue::waitPop(LumaFrame &frame) {
+    QMutexLocker locker(&mutex);
+    while (size == 0 && !interrupted)
+        frameReady.wait(&mutex);
+    if (interrupted)
+        return false;
+
+    frame = frames[head];
+    frames[head] = LumaFrame();
+    head = (head + 1) % int(frames.size());
+    size--;
+    return true;
+}
+
+/**
+ * @brief FrameQueue::interrupt : wake up and stop the consumer waiting in waitPop
+ */
+void FrameQueue::interrupt() {
+    QMutexLocker locker(&mutex);
+    interrupted = true;
+    frameReady.wakeAll();
+}
+
+/**
+ * @brief FrameQueue::pushedCount
+ * @return number of frames offered to the queue
+ */
+quint64 FrameQueue::pushedCount() const {
+    return pushed.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief FrameQueue::droppedCount
+ * @return number of frames that never reached the detector
+ */
+quint64 FrameQueue::droppedCount() const {
+    return dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,49 @@
+#ifndef FRAMEQUEUE_H
+#define FRAMEQUEUE_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <vector>
+#include "lumaframe.h"
+
+/**
+ * @brief The FrameQueue class : bounded hand-off between the frame source and the detection thread.
+ * The source never waits for the detector, when the queue is full the backpressure policy decides which frame goes.
+ */
+class FrameQueue
+{
+public:
+    enum BackpressurePolicy {
+        LatestOnly, // a single slot, a new frame replaces the waiting one
+        DropOldest, // when full, the oldest waiting frame makes room for the new one
+        DropNewest  // when full, the new frame is rejected
+    };
+
+    explicit FrameQueue(int capacity = 2, BackpressurePolicy policy = LatestOnly);
+
+    void setPolicy(int capacity, BackpressurePolicy policy);
+    BackpressurePolicy getPolicy() const;
+
+    void push(const LumaFrame &frame);
+    bool pop(LumaFrame &frame);
+    bool waitPop(LumaFrame &frame);
+    void interrupt();
+
+    quint64 pushedCount() const;
+    quint64 droppedCount() const;
+
+private:
+    mutable QMutex mutex;
+    QWaitCondition frameReady;
+    bool interrupted = false;
+    std::vector<LumaFrame> frames;
+    int head = 0;
+    int size = 0;
+    BackpressurePolicy policy;
+
+    std::atomic<quint64> pushed{0};
+    std::atomic<quint64> dropped{0};
+};
+
+#endif // FRAMEQUEUE_H
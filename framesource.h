@@ -0,0 +1,33 @@
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <QObject>
+#include "lumaframe.h"
+#include "stagestats.h"
+
+/**
+ * @brief The FrameSource class : anything that can feed luminance frames to the FaceFeatureDetector.
+ * frameAvailable may be emitted from any thread.
+ */
+class FrameSource : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FrameSource(QObject *parent = nullptr) : QObject(parent) {
+        qRegisterMetaType<LumaFrame>();
+    }
+
+    virtual bool start() = 0;
+    virtual void stop() = 0;
+
+    //time spent producing each frame, count() is the number of frames captured
+    const StageStats &getCaptureStats() const { return captureStats; }
+
+signals:
+    void frameAvailable(const LumaFrame &frame);
+
+protected:
+    StageStats captureStats;
+};
+
+#endif // FRAMESOURCE_H
@@ -0,0 +1,52 @@
+#include "frustumculler.h"
+#include <QVector4D>
+#include <algorithm>
+#include <limits>
+
+/**
+ * @brief FrustumCuller::setFrustums : extract the planes of the view volumes (Gribb & Hartmann)
+ * @param viewProjections : clip from world, OpenGL clip space
+ * @param count : 1 for mono, 2 for stereo
+ */
+void FrustumCuller::setFrustums(const QMatrix4x4 *viewProjections, int count) {
+    frustums = std::min(count, maxFrustums);
+    for (int f = 0; f < frustums; f++) {
+        const QMatrix4x4 &m = viewProjections[f];
+        //-w <= x, y, z <= w: the planes are the last row plus or minus each other row
+        const QVector4D w = m.row(3);
+        const QVector4D sides[6] = {w + m.row(0), w - m.row(0), w + m.row(1), w - m.row(1), w + m.row(2), w - m.row(2)};
+        for (int p = 0; p < 6; p++) {
+            const float length = sides[p].toVector3D().length();
+            const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+            planes[f][p] = {sides[p].x() * scale, sides[p].y() * scale, sides[p].z() * scale, sides[p].w() * scale};
+        }
+    }
+}
+
+/**
+ * @brief FrustumCuller::cull : find the spheres that are at least partly inside a frustum. The spheres come as one
+ * array per coordinate, read in order, and the loop has no branch to mispredict on a scene that is half visible.
+ * @param x : sphere centers
+ * @param y
+ * @param z
+ * @param radius
+ * @param count : number of spheres
+ * @param visible : receives the indices of the visible spheres, room for count
+ * @return number of visible spheres
+ */
+int FrustumCuller::cull(const float *x, const float *y, const float *z, const float *radius, int count, int *visible) const {
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        bool inside = false;
+        for (int f = 0; f < frustums; f++) {
+            //the distance to the plane the sphere is furthest behind
+            float nearest = std::numeric_limits<float>::max();
+            for (const Plane &plane : planes[f])
+                nearest = std::min(nearest, plane.a * x[i] + plane.b * y[i] + plane.c * z[i] + plane.d + radius[i]);
+            inside |= nearest >= 0.0f;
+        }
+        visible[kept] = i;
+        kept += inside;
+    }
+    return kept;
+}
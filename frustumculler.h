@@ -0,0 +1,29 @@
+#ifndef FRUSTUMCULLER_H
+#define FRUSTUMCULLER_H
+
+#include <QMatrix4x4>
+
+/**
+ * @brief The FrustumCuller class : tests bounding spheres against the planes of view-projection matrices, any
+ * perspective including the asymmetric off-axis ones. In stereo a sphere is kept if either eye sees it.
+ */
+class FrustumCuller
+{
+public:
+    static const int maxFrustums = 2;
+
+    void setFrustums(const QMatrix4x4 *viewProjections, int count);
+    int cull(const float *x, const float *y, const float *z, const float *radius, int count, int *visible) const;
+
+private:
+    // a x + b y + c z + d >= 0 inside, (a, b, c) normalized so d is a distance
+    struct Plane
+    {
+        float a, b, c, d;
+    };
+
+    Plane planes[maxFrustums][6];
+    int frustums = 0;
+};
+
+#endif // FRUSTUMCULLER_H
@@ -0,0 +1,15 @@
+#ifdef GL_ES
+precision mediump int;
+precision highp float;
+#endif
+
+uniform sampler2D sceneTexture;
+
+in vec2 vTexCoord;
+
+out vec4 fragColor;
+
+void main()
+{
+    fragColor = texture(sceneTexture, vTexCoord);
+}
@@ -1,275 +1,273 @@
 #include "glperspectivescene.h"
+#include <QDebug>
+#include <QScreen>
+#include <QTimerEvent>
 
 glPerspectiveScene::glPerspectiveScene(FaceFeatureDetector *detector, QOpenGLWindow::UpdateBehavior updateBehavior, QWindow *parent) :
     QOpenGLWindow(updateBehavior, parent),
     featureDetector(detector),
-    arrayBuffer(QOpenGLBuffer::VertexBuffer),
-    indexBuffer(QOpenGLBuffer::IndexBuffer),
-    wallArrayBuffer(QOpenGLBuffer::VertexBuffer),
-    wallIndexBuffer(QOpenGLBuffer::IndexBuffer),
+    poseFilter(new OneEuroPoseFilter),
     cameraPosition(QVector3D(0.0f, 0.0f, distance))
 {
-    sceneWidth = 3.0;
-    sceneHeight = sceneWidth / aspect;
+    // Swap time: from the end of paintGL until the buffer has been handed to the display
+    connect(this, &QOpenGLWindow::frameSwapped, this, [this]() {
+        if (!paintEndNs)
+            return;
+        qint64 now = monotonicNs();
+        swapStats.record(now - paintEndNs);
+        HotPathTrace::record(HotPathTrace::Swap, paintEndNs, now - paintEndNs);
+        paintEndNs = 0;
+    });
+
+    // Redraw when a new pose comes in, and keep going on vsync while the predicted position still moves
+    connect(detector, &FaceFeatureDetector::headPoseAvailable, this, &glPerspectiveScene::scheduleFrame);
+    connect(this, &QOpenGLWindow::frameSwapped, this, &glPerspectiveScene::scheduleFrame);
+
+    // The first frames are drawn before the textures are decoded, redraw as each one arrives
+    connect(&renderer.getTextureLoader(), &TextureLoader::textureReady, this, [this]() {
+        redrawPending = true;
+        scheduleFrame();
+    });
+
+    // Printed along with the detection stages of the FaceFeatureDetector
+    statsTimer.start(5000, this);
 }
 
 glPerspectiveScene::~glPerspectiveScene()
 {
     makeCurrent();
-
-    arrayBuffer.destroy();
-    indexBuffer.destroy();
-    wallArrayBuffer.destroy();
-    wallIndexBuffer.destroy();
-
-    delete skyTexture;
-    delete cubeTexture;
-
+    renderer.destroy();
     doneCurrent();
 }
 
-void glPerspectiveScene::timerEvent(QTimerEvent *)
+/**
+ * @brief glPerspectiveScene::setPoseFilter : replace the filter applied to the detected head positions
+ * @param filter : takes ownership
+ */
+void glPerspectiveScene::setPoseFilter(PoseFilter *filter)
 {
-    update();
+    poseFilter.reset(filter);
+    lastPoseSequence = 0;
+    redrawPending = true;
 }
 
-void glPerspectiveScene::initializeGL()
+/**
+ * @brief glPerspectiveScene::getPaintStats
+ * @return timing of paintGL
+ */
+const StageStats &glPerspectiveScene::getPaintStats() const
 {
-    initializeOpenGLFunctions();
-
-    glClearColor(0, 0, 0, 1);
-
-    initShaders();
-    loadTextures();
-
-    // Enable depth buffer
-    glEnable(GL_DEPTH_TEST);
-
-    // Enable back face culling
-    glEnable(GL_CULL_FACE);
-
-    // Generate all VBOs
-    arrayBuffer.create();
-    indexBuffer.create();
-    wallArrayBuffer.create();
-    wallIndexBuffer.create();
-
-    // Use QBasicTimer because its faster than QTimer
-    timer.start(8, this);
+    return paintStats;
 }
 
-void glPerspectiveScene::initShaders()
+/**
+ * @brief glPerspectiveScene::getSwapStats
+ * @return timing of the buffer swaps
+ */
+const StageStats &glPerspectiveScene::getSwapStats() const
 {
-    // Compile vertex shader
-    if (!program.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/vshader.glsl")) {
-        qDebug() <<  "\nVERTEX SHADER ERROR\n";
-        close();
-    }
-
-    // Compile fragment shader
-    if (!program.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/fshader.glsl")) {
-        qDebug() <<  "\nFRAGMENT SHADER ERROR\n";
-        close();
-    }
-
-    // Link shader pipeline
-    if (!program.link()) {
-        qDebug() <<  "\nLINKING SHADERS ERROR\n";
-        close();
-    }
-
-    // Bind shader pipeline for use
-    if (!program.bind()) {
-        qDebug() <<  "\nBINDING ERROR\n";
-        close();
-    }
+    return swapStats;
 }
 
-void glPerspectiveScene::loadTextures()
+/**
+ * @brief glPerspectiveScene::setRedrawThreshold
+ * @param threshold : how far the predicted head position must move, in scene units, before a frame is drawn
+ */
+void glPerspectiveScene::setRedrawThreshold(float threshold)
 {
-    //cube textures
-    cubeTexture = new QOpenGLTexture(QOpenGLTexture::Target2D);
-    cubeTexture->setMinificationFilter(QOpenGLTexture::Linear);
-    cubeTexture->setMagnificationFilter(QOpenGLTexture::Linear);
-    cubeTexture->setWrapMode(QOpenGLTexture::Repeat);
-    cubeTexture->setData(QImage(":/rubix_cube_texture.jpg"));
-
-    //skybox textures
-    skyTexture = new QOpenGLTexture(QOpenGLTexture::Target2D);
-    skyTexture->setMinificationFilter(QOpenGLTexture::Linear);
-    skyTexture->setMagnificationFilter(QOpenGLTexture::Linear);
-    skyTexture->setWrapMode(QOpenGLTexture::Repeat);
-    skyTexture->setData(QImage(":/gridpat3.jpg"));
+    redrawThreshold = threshold;
 }
 
-void glPerspectiveScene::resizeGL(int w, int h)
+/**
+ * @brief glPerspectiveScene::setMaxFrameRate
+ * @param fps : cap on the frames drawn per second
+ */
+void glPerspectiveScene::setMaxFrameRate(int fps)
 {
-    // Recalculate aspect ratio
-    aspect = qreal(w) / qreal(h ? h : 1);
-
-    sceneWidth = 3.0;
-    sceneHeight = sceneWidth / aspect;
-
+    maxFrameRate = qMax(1, fps);
 }
 
-void glPerspectiveScene::paintGL()
+/**
+ * @brief glPerspectiveScene::setStereoMode
+ * @param mode : Mono draws from the midpoint between the eyes, SideBySide from each eye
+ */
+void glPerspectiveScene::setStereoMode(StereoMode mode)
 {
-    // Clear color and depth buffer
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    //reset matrices
-    viewFrustrum.setToIdentity();
-
-    float z = 0.0f;
-    const QVector3D pa = QVector3D(-sceneWidth, -sceneHeight, z);
-    const QVector3D pb = QVector3D(sceneWidth, -sceneHeight, z);
-    const QVector3D pc = QVector3D(-sceneWidth, sceneHeight, z);
-
-    determineCameraPosition(); //magic
-
-    viewFrustrum = projFrustum(pa, pb, pc, cameraPosition, zNear, zFar); //more magic
-    program.setUniformValue("viewFrustrum", viewFrustrum);
-
-    transform.setToIdentity();
-    transform.scale(QVector3D(sceneWidth, sceneHeight, 5.0f));
-    program.setUniformValue("transform", transform);
-
-    glCullFace(GL_FRONT);
-    drawSkyBox();
+    stereoMode = mode;
+    redrawPending = true;
+}
 
-    transform.setToIdentity();
-    transform.rotate((25.0f), QVector3D(1.0f, 0.0f, 0.0f));
-    transform.rotate((45.0f), QVector3D(0.0f, 1.0f, 0.0f));
-    program.setUniformValue("transform", transform);
+/**
+ * @brief glPerspectiveScene::getStereoMode
+ * @return how the frames are drawn
+ */
+glPerspectiveScene::StereoMode glPerspectiveScene::getStereoMode() const
+{
+    return stereoMode;
+}
 
-    glCullFace(GL_BACK);
-    drawCube();
+/**
+ * @brief glPerspectiveScene::getRenderedFrames
+ * @return frames drawn
+ */
+quint64 glPerspectiveScene::getRenderedFrames() const
+{
+    return renderedFrames;
 }
 
-void glPerspectiveScene::determineCameraPosition()
+/**
+ * @brief glPerspectiveScene::getSkippedFrames
+ * @return redraw opportunities (new poses, vsyncs) left out because the head did not move enough
+ */
+quint64 glPerspectiveScene::getSkippedFrames() const
 {
-    QRect face = featureDetector->getFaceRect();
-    QRect leye = featureDetector->getLeftEyeRect();
-    QRect reye = featureDetector->getRightEyeRect();
+    return skippedFrames;
+}
 
-    if (face.x() == 0 || reye.x() == 0 || leye.x() == 0)
+void glPerspectiveScene::timerEvent(QTimerEvent *e)
+{
+    if (e->timerId() == statsTimer.timerId()) {
+        logStats();
         return;
+    }
 
-    QSize imageSize = featureDetector->getImageSize();
-    float distFromCamera = featureDetector->getDistanceFromCamera();
-    zFar = distFromCamera;
-
-    int centerEyesX = (leye.x() + reye.right()) / 2;
-    int centerEyesY = leye.y() + leye.height() / 2;
-
-    float ratio = 0.05f;
-    int x = centerEyesX - imageSize.width() / 2;
-    int y = centerEyesY - imageSize.height() / 2;
-
-    cameraPosition.setX(x * ratio);
-    cameraPosition.setY(-y * ratio);
-    cameraPosition.setZ(distFromCamera / 3.5f);
+    // The frame rate cap has passed
+    frameCapTimer.stop();
+    scheduleFrame();
 }
 
-void glPerspectiveScene::initAttributes()
+/**
+ * @brief glPerspectiveScene::logStats : print the paint and swap latency, and how many frames were drawn or skipped
+ */
+void glPerspectiveScene::logStats()
 {
-    // Offset for position
-    int offset = 0;
-
-    // Tell OpenGL programmable pipeline how to locate vertex position data
-    int vertexLocation = program.attributeLocation("aPosition");
-    program.enableAttributeArray(vertexLocation);
-    program.setAttributeBuffer(vertexLocation, GL_FLOAT, offset, 3, sizeof(VertexData));
-
-    // Offset for texture coordinate
-    offset += sizeof(QVector3D);
-
-    // Tell OpenGL programmable pipeline how to locate vertex texture coordinate data
-    int texcoordLocation = program.attributeLocation("aTexCoord");
-    program.enableAttributeArray(texcoordLocation);
-    program.setAttributeBuffer(texcoordLocation, GL_FLOAT, offset, 2, sizeof(VertexData));
+    auto print = [](const char *name, const StageStats &stats) {
+        qDebug().nospace() << name << ": " << stats.count() << " frames, "
+                           << stats.throughput() << " fps, avg " << stats.averageMs()
+                           << " ms, max " << stats.maxMs() << " ms";
+    };
+    print("paint", paintStats);
+    print("swap", swapStats);
+    qDebug().nospace() << "scene: " << renderedFrames << " frames drawn, " << skippedFrames << " skipped";
 }
 
-void glPerspectiveScene::drawCube()
+/**
+ * @brief glPerspectiveScene::scheduleFrame : ask for a frame if the head moved enough since the last one,
+ * otherwise stay idle until the next pose
+ */
+void glPerspectiveScene::scheduleFrame()
 {
-    arrayBuffer.bind();
-    arrayBuffer.allocate(vertices, vertexArraySize * sizeof(VertexData));
-
-    indexBuffer.bind();
-    indexBuffer.allocate(indices, indexArraySize * sizeof(GLushort));
+    if (frameCapTimer.isActive())
+        return;
 
-    initAttributes();
+    ingestHeadPose();
+
+    qint64 now = monotonicNs();
+    if (!redrawPending) {
+        if (!poseFilter->hasSamples()) {
+            skippedFrames++;
+            return;
+        }
+        QVector3D next = poseFilter->predict(now + displayLatencyNs);
+        if ((next - renderedPosition).length() < redrawThreshold) {
+            skippedFrames++;
+            return;
+        }
+    }
 
-    cubeTexture->bind();
+    // Vsync already holds the frames to the refresh rate, a cap at or above it would only drop vsyncs
+    const qreal refreshRate = screen() ? screen()->refreshRate() : 0.0;
+    if (refreshRate <= 0.0 || maxFrameRate < refreshRate) {
+        // Paint starts are compared, with an eighth of a period of slack for the jitter of the vsync wakeups
+        const qint64 period = qint64(1e9 / maxFrameRate);
+        qint64 wait = lastPaintNs + period - period / 8 - now;
+        if (wait > 0) {
+            frameCapTimer.start(int((wait + 999999) / 1000000), Qt::PreciseTimer, this);
+            return;
+        }
+    }
 
-    // Draw cube geometry using indices from VBO 1
-    glDrawElements(GL_TRIANGLE_STRIP, indexArraySize, GL_UNSIGNED_SHORT, nullptr);
+    redrawPending = false;
+    update(); //drawn on the next vsync
 }
 
-void glPerspectiveScene::drawSkyBox()
+void glPerspectiveScene::initializeGL()
 {
-    wallArrayBuffer.bind();
-    wallArrayBuffer.allocate(wallVertices, wallArrayBufferSize * sizeof(VertexData));
+    // A frame is on screen about one refresh after paintGL, the head pose is predicted for then
+    if (screen() && screen()->refreshRate() > 0)
+        displayLatencyNs = qint64(1e9 / screen()->refreshRate());
 
-    wallIndexBuffer.bind();
-    wallIndexBuffer.allocate(wallIndices, wallIndexBufferSize * sizeof(GLushort));
+    if (!renderer.initialize())
+        close();
+}
 
-    initAttributes();
+void glPerspectiveScene::resizeGL(int w, int h)
+{
+    // The renderer sets viewports itself in stereo, it gets the size in device pixels
+    renderer.resize(int(w * devicePixelRatio()), int(h * devicePixelRatio()));
+}
 
-    skyTexture->bind();
+void glPerspectiveScene::paintGL()
+{
+    lastPaintNs = monotonicNs();
+    {
+        ScopedStageTimer timer(paintStats, HotPathTrace::Paint);
+        determineCameraPosition(); //magic
+        if (stereoMode == SideBySide)
+            renderer.renderStereo(cameraPosition - eyeOffset, cameraPosition + eyeOffset, zFar);
+        else
+            renderer.render(cameraPosition, zFar); //more magic
+    }
+    paintEndNs = monotonicNs();
 
-    // Draw cube geometry using indices from VBO 1
-    glDrawElements(GL_TRIANGLE_STRIP, wallIndexBufferSize, GL_UNSIGNED_SHORT, nullptr);
+    renderedPosition = cameraPosition;
+    redrawPending = false;
+    renderedFrames++;
 }
 
-QMatrix4x4 glPerspectiveScene::projFrustum(
-        const QVector3D pa,
-        const QVector3D pb,
-        const QVector3D pc,
-        const QVector3D pe,
-        float n, float f)
+/**
+ * @brief glPerspectiveScene::ingestHeadPose : feed the latest detected pose to the filter, once per detected frame
+ */
+void glPerspectiveScene::ingestHeadPose()
 {
-    QVector3D va, vb, vc;
-    QVector3D vr, vu, vn;
+    const HeadPose pose = featureDetector->latestHeadPose();
 
-    QMatrix4x4 frustum;
+    // Feed each detected frame to the filter once
+    if (pose.hasEyes() && pose.sequence != lastPoseSequence) {
+        lastPoseSequence = pose.sequence;
 
-    float l, r, b, t, d, M[16];
+        const QRectF &leye = pose.leftEye;
+        const QRectF &reye = pose.rightEye;
+        const QSize &imageSize = pose.imageSize;
+        float distFromCamera = pose.distanceFromCamera;
 
-    // Compute an orthonormal basis for the screen.
-    vr = pb - pa; 
-    vu = pc - pa; 
-    vr.normalize(); 
-    vu.normalize(); 
-    vn = QVector3D::crossProduct(vr, vu); 
-    vn.normalize(); 
+        float centerEyesX = float(leye.x() + reye.right()) / 2.0f;
+        float centerEyesY = float(leye.y() + leye.height() / 2.0);
 
-    // Compute the screen corner vectors.
-    va = pa - pe; 
-    vb = pb - pe; 
-    vc = pc - pe; 
+        float ratio = 0.05f;
+        float x = centerEyesX - imageSize.width() / 2.0f;
+        float y = centerEyesY - imageSize.height() / 2.0f;
 
-    // Find the distance from the eye to screen plane.
-    d = -QVector3D::dotProduct(va, vn); 
+        poseFilter->update(QVector3D(x * ratio, -y * ratio, distFromCamera / 3.5f), pose.timestampNs);
 
-    // Find the extent of the perpendicular projection.
-    l = QVector3D::dotProduct(vr, va) * n / d; 
-    r = QVector3D::dotProduct(vr, vb) * n / d; 
-    b = QVector3D::dotProduct(vu, va) * n / d; 
-    t = QVector3D::dotProduct(vu, vc) * n / d; 
-
-    // Rotate the projection to be non-perpendicular.
-    memset(M, 0, 16 * sizeof(float));
-    M[0] = vr.x(); M[4] = vr.y(); M[ 8] = vr.z();
-    M[1] = vu.x(); M[5] = vu.y(); M[ 9] = vu.z();
-    M[2] = vn.x(); M[6] = vn.y(); M[10] = vn.z();
-    M[15] = 1.0f;
+        // The distance between the eyes barely changes, a light smoothing of it is enough for stereo
+        QPointF between = (reye.center() - leye.center()) / 2.0;
+        QVector3D offset(float(between.x()) * ratio, -float(between.y()) * ratio, 0.0f);
+        if (offset.x() < 0.0f)
+            offset = -offset; //the offset points at the eye drawn on the right
+        eyeOffset = hasEyeOffset ? eyeOffset * 0.8f + offset * 0.2f : offset;
+        hasEyeOffset = true;
+    }
+}
 
-    frustum.frustum(l, r, b, t, n, f); 
-    frustum = frustum * QMatrix4x4(M);
+void glPerspectiveScene::determineCameraPosition()
+{
+    ingestHeadPose();
 
-    // Move the apex of the frustum to the origin.
-    frustum.translate(-pe);
+    if (!poseFilter->hasSamples())
+        return;
 
-    return frustum;
+    // Extrapolate to when this frame will be displayed, detection runs slower than the display
+    cameraPosition = poseFilter->predict(monotonicNs() + displayLatencyNs);
+    zFar = cameraPosition.z() * 3.5f;
 }
@@ -0,0 +1,34 @@
+#ifndef HEADPOSE_H
+#define HEADPOSE_H
+
+#include <QRect>
+#include <QRectF>
+#include <QSize>
+#include "monotonicclock.h"
+
+/**
+ * @brief The HeadPose struct : everything the detector found in one frame.
+ * A pose is published as a whole, so all fields always come from the same frame.
+ */
+struct HeadPose
+{
+    enum TrackState {
+        NoFace,     // nothing found, the rects are empty
+        FaceOnly,   // face found but not both eyes
+        FaceAndEyes // face and both eyes found, distanceFromCamera is valid
+    };
+
+    TrackState state = NoFace;
+    QRect face;
+    QRectF rightEye;        // sub-pixel when the eyes are followed by optical flow
+    QRectF leftEye;
+    float distanceFromCamera = 0.0f;
+    QSize imageSize;
+    quint64 sequence = 0;   // frame number, increases by one per captured frame
+    qint64 timestampNs = 0; // capture time on the monotonicNs() clock
+
+    bool hasFace() const { return state != NoFace; }
+    bool hasEyes() const { return state == FaceAndEyes; }
+};
+
+#endif // HEADPOSE_H
@@ -0,0 +1,229 @@
+#include "hotpathtrace.h"
+#include "monotonicclock.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+std::atomic<bool> HotPathTrace::enabled{true};
+
+namespace {
+
+/*
+ * One ring per thread, written only by that thread. Each slot is a small seqlock: the writer marks the slot odd
+ * while it fills it, readers copy the slot and drop it if the sequence changed under them.
+ */
+struct TraceSlot
+{
+    std::atomic<quint64> sequence{0};
+    std::atomic<qint64> startNs{0};
+    std::atomic<qint64> durationNs{0};
+    std::atomic<int> stage{0};
+};
+
+struct TraceSample
+{
+    qint64 startNs;
+    qint64 durationNs;
+    int stage;
+};
+
+struct TraceRing
+{
+    static const int capacity = 4096;
+
+    TraceSlot slots[capacity];
+    std::atomic<quint64> written{0};
+    int threadId = 0;
+    QString threadName;
+
+    void push(int stage, qint64 startNs, qint64 durationNs) {
+        quint64 n = written.load(std::memory_order_relaxed);
+        TraceSlot &slot = slots[n % capacity];
+        slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.startNs.store(startNs, std::memory_order_relaxed);
+        slot.durationNs.store(durationNs, std::memory_order_relaxed);
+        slot.stage.store(stage, std::memory_order_relaxed);
+        slot.sequence.store(2 * n + 2, std::memory_order_release);
+        written.store(n + 1, std::memory_order_release);
+    }
+
+    void snapshot(std::vector<TraceSample> &samples) const {
+        quint64 end = written.load(std::memory_order_acquire);
+        quint64 begin = end > quint64(capacity) ? end - capacity : 0;
+        for (quint64 n = begin; n < end; n++) {
+            const TraceSlot &slot = slots[n % capacity];
+            quint64 before = slot.sequence.load(std::memory_order_acquire);
+            if (before != 2 * n + 2)
+                continue; //already overwritten
+            TraceSample sample;
+            sample.startNs = slot.startNs.load(std::memory_order_relaxed);
+            sample.durationNs = slot.durationNs.load(std::memory_order_relaxed);
+            sample.stage = slot.stage.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == before)
+                samples.push_back(sample);
+        }
+    }
+};
+
+QMutex registryMutex;
+std::vector<std::unique_ptr<TraceRing>> registry; //rings outlive their threads so they can still be exported
+thread_local TraceRing *threadRing = nullptr;
+
+TraceRing *ringForThisThread() {
+    if (threadRing)
+        return threadRing;
+
+    //first sample of this thread: the only allocation a thread ever makes for tracing
+    QMutexLocker locker(&registryMutex);
+    registry.emplace_back(new TraceRing);
+    threadRing = registry.back().get();
+    threadRing->threadId = int(registry.size());
+    QThread *thread = QThread::currentThread();
+    threadRing->threadName = thread && !thread->objectName().isEmpty()
+            ? thread->objectName() : QString("thread %1").arg(threadRing->threadId);
+    return threadRing;
+}
+
+}
+
+/**
+ * @brief HotPathTrace::setEnabled
+ * @param on : false turns record() into a no-op
+ */
+void HotPathTrace::setEnabled(bool on) {
+    enabled.store(on, std::memory_order_relaxed);
+}
+
+/**
+ * @brief HotPathTrace::isEnabled
+ * @return true if samples are recorded
+ */
+bool HotPathTrace::isEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief HotPathTrace::record : add a sample to the ring of the calling thread, lock-free
+ * @param stage
+ * @param startNs : start on the monotonicNs() clock
+ * @param durationNs
+ */
+void HotPathTrace::record(Stage stage, qint64 startNs, qint64 durationNs) {
+    if (stage == None || !isEnabled())
+        return;
+    ringForThisThread()->push(stage, startNs, durationNs);
+}
+
+/**
+ * @brief HotPathTrace::stageName
+ * @param stage
+ * @return name used in the exports
+ */
+const char *HotPathTrace::stageName(Stage stage) {
+    switch (stage) {
+    case Capture: return "capture";
+    case Convert: return "convert";
+    case MotionGate: return "motion-gate";
+    case FaceDetect: return "face-detect";
+    case EyeDetect: return "eye-detect";
+    case Distance: return "distance";
+    case PosePublish: return "pose-publish";
+    case Paint: return "paintGL";
+    case Swap: return "buffer-swap";
+    default: return "unknown";
+    }
+}
+
+/**
+ * @brief HotPathTrace::summarize : rolling percentiles of a stage, over all threads
+ * @param stage
+ * @param windowNs : only the samples that started this recently are used, 0 for everything still in the rings
+ * @return count and p50/p95/p99 durations
+ */
+HotPathTrace::Summary HotPathTrace::summarize(Stage stage, qint64 windowNs) {
+    std::vector<TraceSample> samples;
+    {
+        QMutexLocker locker(&registryMutex);
+        for (const std::unique_ptr<TraceRing> &ring : registry)
+            ring->snapshot(samples);
+    }
+
+    qint64 since = windowNs > 0 ? monotonicNs() - windowNs : 0;
+    std::vector<qint64> durations;
+    for (const TraceSample &sample : samples)
+        if (sample.stage == stage && sample.startNs >= since)
+            durations.push_back(sample.durationNs);
+
+    Summary summary;
+    summary.count = durations.size();
+    if (durations.empty())
+        return summary;
+
+    std::sort(durations.begin(), durations.end());
+    auto percentile = [&durations](double p) {
+        size_t index = std::min(durations.size() - 1, size_t(p * durations.size()));
+        return durations[index] / 1e6;
+    };
+    summary.p50Ms = percentile(0.50);
+    summary.p95Ms = percentile(0.95);
+    summary.p99Ms = percentile(0.99);
+    return summary;
+}
+
+/**
+ * @brief HotPathTrace::chromeTraceJson : everything still in the rings, in the Chrome trace event format
+ * @return the JSON document
+ */
+QByteArray HotPathTrace::chromeTraceJson() {
+    QJsonArray events;
+
+    QMutexLocker locker(&registryMutex);
+    std::vector<TraceSample> samples;
+    for (const std::unique_ptr<TraceRing> &ring : registry) {
+        QJsonObject threadName;
+        threadName["name"] = "thread_name";
+        threadName["ph"] = "M";
+        threadName["pid"] = 1;
+        threadName["tid"] = ring->threadId;
+        threadName["args"] = QJsonObject{{"name", ring->threadName}};
+        events.append(threadName);
+
+        samples.clear();
+        ring->snapshot(samples);
+        for (const TraceSample &sample : samples) {
+            QJsonObject event;
+            event["name"] = stageName(Stage(sample.stage));
+            event["ph"] = "X";
+            event["pid"] = 1;
+            event["tid"] = ring->threadId;
+            event["ts"] = sample.startNs / 1e3;     //microseconds
+            event["dur"] = sample.durationNs / 1e3;
+            events.append(event);
+        }
+    }
+
+    QJsonObject trace;
+    trace["traceEvents"] = events;
+    trace["displayTimeUnit"] = "ms";
+    return QJsonDocument(trace).toJson(QJsonDocument::Compact);
+}
+
+/**
+ * @brief HotPathTrace::writeChromeTrace
+ * @param path : file to write the Chrome trace JSON to
+ * @return false if the file could not be written
+ */
+bool HotPathTrace::writeChromeTrace(const QString &path) {
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+        return false;
+    return file.write(chromeTraceJson()) >= 0;
+}
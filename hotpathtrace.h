@@ -0,0 +1,50 @@
+#ifndef HOTPATHTRACE_H
+#define HOTPATHTRACE_H
+
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+
+/**
+ * @brief The HotPathTrace class : timestamped samples of every hot path stage, kept in a lock-free ring buffer
+ * per thread. Recording is two clock reads and a ring write, cheap enough to stay on in production builds.
+ * The rings can be exported as Chrome trace JSON (chrome://tracing, Perfetto) or summarized as percentiles.
+ */
+class HotPathTrace
+{
+public:
+    enum Stage {
+        None = -1,
+        Capture,
+        Convert,
+        MotionGate,
+        FaceDetect,
+        EyeDetect,
+        Distance,
+        PosePublish,
+        Paint,
+        Swap,
+        StageCount
+    };
+
+    struct Summary
+    {
+        quint64 count = 0;
+        double p50Ms = 0.0, p95Ms = 0.0, p99Ms = 0.0;
+    };
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    static void record(Stage stage, qint64 startNs, qint64 durationNs);
+
+    static const char *stageName(Stage stage);
+    static Summary summarize(Stage stage, qint64 windowNs);
+    static QByteArray chromeTraceJson();
+    static bool writeChromeTrace(const QString &path);
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+#endif // HOTPATHTRACE_H
@@ -0,0 +1,115 @@
+#include "ktxfile.h"
+#include <QDebug>
+#include <cstring>
+
+static const char identifier[12] = {'\xAB', 'K', 'T', 'X', ' ', '1', '1', '\xBB', '\r', '\n', '\x1A', '\n'};
+static const quint32 endianness = 0x04030201;
+static const quint32 glRgba = 0x1908;
+
+// fields after the identifier, in file order
+struct KtxHeader
+{
+    quint32 endianness;
+    quint32 glType;
+    quint32 glTypeSize;
+    quint32 glFormat;
+    quint32 glInternalFormat;
+    quint32 glBaseInternalFormat;
+    quint32 pixelWidth;
+    quint32 pixelHeight;
+    quint32 pixelDepth;
+    quint32 numberOfArrayElements;
+    quint32 numberOfFaces;
+    quint32 numberOfMipmapLevels;
+    quint32 bytesOfKeyValueData;
+};
+
+static int padding(quint32 size) {
+    return int(3 - ((size + 3) % 4));
+}
+
+/**
+ * @brief TextureData::byteSize
+ * @return bytes of all the levels
+ */
+qint64 TextureData::byteSize() const {
+    qint64 bytes = 0;
+    for (const QByteArray &level : levels)
+        bytes += level.size();
+    return bytes;
+}
+
+/**
+ * @brief KtxFile::read : parse a KTX file held in memory. Only single 2D textures written in the byte order of
+ * this machine are supported, which is what texture tools write on every platform the app runs on.
+ * @param data : the file
+ * @param texture : receives the texture
+ * @return false if the file is not such a texture or is truncated
+ */
+bool KtxFile::read(const QByteArray &data, TextureData &texture) {
+    KtxHeader header;
+    if (data.size() < int(sizeof(identifier) + sizeof(header)) || memcmp(data.constData(), identifier, sizeof(identifier)))
+        return false;
+    memcpy(&header, data.constData() + sizeof(identifier), sizeof(header));
+
+    if (header.endianness != endianness || header.pixelDepth || header.numberOfArrayElements || header.numberOfFaces != 1
+            || !header.pixelWidth || !header.pixelHeight) {
+        qDebug() << "Unsupported KTX texture";
+        return false;
+    }
+
+    const int levelCount = int(qMax(1u, header.numberOfMipmapLevels));
+    qint64 offset = qint64(sizeof(identifier) + sizeof(header)) + header.bytesOfKeyValueData;
+
+    texture = TextureData();
+    texture.glInternalFormat = header.glInternalFormat;
+    texture.glFormat = header.glFormat;
+    texture.glType = header.glType;
+    texture.size = QSize(int(header.pixelWidth), int(header.pixelHeight));
+    for (int level = 0; level < levelCount; level++) {
+        quint32 imageSize;
+        if (offset + qint64(sizeof(imageSize)) > data.size())
+            return false;
+        memcpy(&imageSize, data.constData() + offset, sizeof(imageSize));
+        offset += sizeof(imageSize);
+        if (offset + imageSize > data.size())
+            return false;
+        texture.levels.append(data.mid(int(offset), int(imageSize)));
+        offset += imageSize + padding(imageSize);
+    }
+    return true;
+}
+
+/**
+ * @brief KtxFile::write : serialize a texture into a KTX file
+ * @param texture
+ * @return the file
+ */
+QByteArray KtxFile::write(const TextureData &texture) {
+    KtxHeader header;
+    header.endianness = endianness;
+    header.glType = texture.glType;
+    header.glTypeSize = 1; // 8 bit components, compressed data counts as bytes too
+    header.glFormat = texture.glFormat;
+    header.glInternalFormat = texture.glInternalFormat;
+    header.glBaseInternalFormat = texture.isCompressed() ? glRgba : texture.glFormat;
+    header.pixelWidth = quint32(texture.size.width());
+    header.pixelHeight = quint32(texture.size.height());
+    header.pixelDepth = 0;
+    header.numberOfArrayElements = 0;
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = quint32(texture.levels.size());
+    header.bytesOfKeyValueData = 0;
+
+    QByteArray out;
+    out.reserve(int(sizeof(identifier) + sizeof(header) + texture.byteSize() + 8 * texture.levels.size()));
+    out.append(identifier, sizeof(identifier));
+    out.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const QByteArray &level : texture.levels) {
+        const quint32 imageSize = quint32(level.size());
+        out.append(reinterpret_cast<const char *>(&imageSize), sizeof(imageSize));
+        out.append(level);
+        out.append(padding(imageSize), '\0');
+    }
+    return out;
+}
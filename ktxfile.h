@@ -0,0 +1,34 @@
+#ifndef KTXFILE_H
+#define KTXFILE_H
+
+#include <QByteArray>
+#include <QSize>
+#include <QVector>
+
+/**
+ * @brief The TextureData struct : a 2D texture with its whole mip chain, ready to upload
+ */
+struct TextureData
+{
+    quint32 glInternalFormat = 0;
+    quint32 glFormat = 0;       // 0 for compressed formats
+    quint32 glType = 0;         // 0 for compressed formats
+    QSize size;
+    QVector<QByteArray> levels; // level 0 first, each half the size of the one before
+
+    bool isCompressed() const { return glFormat == 0; }
+    bool isEmpty() const { return levels.isEmpty(); }
+    qint64 byteSize() const;
+};
+
+/**
+ * @brief The KtxFile class : reads and writes 2D textures in the KTX 1.1 container, compressed (ETC2, ASTC...) or not
+ */
+class KtxFile
+{
+public:
+    static bool read(const QByteArray &data, TextureData &texture);
+    static QByteArray write(const TextureData &texture);
+};
+
+#endif // KTXFILE_H
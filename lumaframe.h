@@ -0,0 +1,24 @@
+#ifndef LUMAFRAME_H
+#define LUMAFRAME_H
+
+#include <QMetaType>
+#include <memory>
+#include <opencv2/core.hpp>
+
+/**
+ * @brief The LumaFrame struct : one frame handed from a FrameSource to the detector.
+ * gray (or bgra) may be a view straight into a camera buffer, keepAlive holds that buffer (mapped) until the
+ * last copy of the frame is gone.
+ */
+struct LumaFrame
+{
+    cv::Mat gray;           // 8 bit luminance
+    cv::Mat bgra;           // set instead of gray for packed RGB cameras, converted by the detector
+    std::shared_ptr<void> keepAlive;
+    int orientation = 0;    // anti-clockwise rotation to make the frame upright, same as VideoOutput.orientation
+    quint64 sequence = 0;   // frame number, increases by one per captured frame
+    qint64 timestampNs = 0; // capture time on the monotonicNs() clock
+};
+Q_DECLARE_METATYPE(LumaFrame)
+
+#endif // LUMAFRAME_H
@@ -0,0 +1,482 @@
+#include "lumakernels.h"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LUMA_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define LUMA_NEON
+#include <arm_neon.h>
+#endif
+
+/*
+ * BT.601 luma in 8 bit fixed point, the weights add up to 256:
+ * Y = (29 * B + 150 * G + 77 * R + 128) >> 8
+ * A factor x factor block is summed first, the block size is folded into the shift.
+ */
+static const int weightB = 29, weightG = 150, weightR = 77;
+
+static int shiftFor(int factor) {
+    return factor == 4 ? 12 : factor == 2 ? 10 : 8;
+}
+
+/**
+ * @brief scalarRows : scalar kernel for the output columns [fromX, dstWidth)
+ */
+static void scalarRows(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                       int fromX, int dstWidth, int dstHeight, int factor, uint32_t *histogram) {
+    const int shift = shiftFor(factor);
+    const int round = 1 << (shift - 1);
+
+    for (int y = 0; y < dstHeight; y++) {
+        const uint8_t *block = src + y * factor * srcStride;
+        uint8_t *out = dst + y * dstStride;
+        for (int x = fromX; x < dstWidth; x++) {
+            int b = 0, g = 0, r = 0;
+            for (int dy = 0; dy < factor; dy++) {
+                const uint8_t *p = block + dy * srcStride + x * factor * 4;
+                for (int dx = 0; dx < factor; dx++, p += 4) {
+                    b += p[0];
+                    g += p[1];
+                    r += p[2];
+                }
+            }
+            uint8_t luma = uint8_t((weightB * b + weightG * g + weightR * r + round) >> shift);
+            out[x] = luma;
+            if (histogram)
+                histogram[luma]++;
+        }
+    }
+}
+
+/**
+ * @brief scalarLumaRows : scalar luma downscale for the output columns [fromX, dstWidth)
+ */
+static void scalarLumaRows(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                           int fromX, int dstWidth, int dstHeight, int factor, uint32_t *histogram) {
+    const int shift = factor == 4 ? 4 : factor == 2 ? 2 : 0;
+    const int round = shift ? 1 << (shift - 1) : 0;
+
+    for (int y = 0; y < dstHeight; y++) {
+        const uint8_t *block = src + y * factor * srcStride;
+        uint8_t *out = dst + y * dstStride;
+        for (int x = fromX; x < dstWidth; x++) {
+            int sum = 0;
+            for (int dy = 0; dy < factor; dy++) {
+                const uint8_t *p = block + dy * srcStride + x * factor;
+                for (int dx = 0; dx < factor; dx++)
+                    sum += p[dx];
+            }
+            uint8_t luma = uint8_t((sum + round) >> shift);
+            out[x] = luma;
+            if (histogram)
+                histogram[luma]++;
+        }
+    }
+}
+
+void LumaKernels::downscaleLumaScalar(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                                      int dstWidth, int dstHeight, int factor, uint32_t *histogram) {
+    scalarLumaRows(src, srcStride, dst, dstStride, 0, dstWidth, dstHeight, factor, histogram);
+}
+
+void LumaKernels::bgraToLumaScalar(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                                   int dstWidth, int dstHeight, int factor, uint32_t *histogram) {
+    scalarRows(src, srcStride, dst, dstStride, 0, dstWidth, dstHeight, factor, histogram);
+}
+
+/**
+ * @brief LumaKernels::AreaAxis::build : the share of every source pixel in the outputs it overlaps. The weights are
+ * rounded on the running sum, so each output adds up to exactly 256.
+ * @param srcSize
+ * @param dstSize : at most srcSize
+ */
+void LumaKernels::AreaAxis::build(int srcSize, int dstSize) {
+    this->srcSize = srcSize;
+    this->dstSize = dstSize;
+    first.resize(dstSize);
+    count.resize(dstSize);
+    offset.resize(dstSize);
+    weights.clear();
+
+    const double scale = double(srcSize) / dstSize;
+    for (int i = 0; i < dstSize; i++) {
+        const double begin = i * scale, end = (i + 1) * scale;
+        first[i] = int(begin);
+        offset[i] = int(weights.size());
+        double covered = 0.0;
+        int rounded = 0;
+        for (int j = first[i]; j < srcSize && j < end; j++) {
+            covered += std::min(end, j + 1.0) - std::max(begin, double(j));
+            int next = int(covered / scale * 256.0 + 0.5);
+            if (next == rounded && j > first[i])
+                break; //a sliver of the next source, below the precision
+            weights.push_back(uint16_t(next - rounded));
+            rounded = next;
+        }
+        count[i] = int(weights.size()) - offset[i];
+        weights.back() += uint16_t(256 - rounded);
+    }
+}
+
+/*
+ * The area kernels reduce each source row horizontally to luma * 256 (at most 65280), add the rows of an output row
+ * with their weights (at most 65280 * 256, fits 32 bit) and round the result by 16 bits.
+ * A source row shared by two output rows is reduced once.
+ */
+template <bool bgra>
+static void areaRows(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                     const LumaKernels::AreaAxis &columns, const LumaKernels::AreaAxis &rows,
+                     uint32_t *buffer, uint32_t *histogram) {
+    const int dstWidth = columns.dstSize;
+    uint32_t *reduced = buffer;             // the last reduced source row
+    uint32_t *sum = buffer + dstWidth;      // the weighted rows of the current output row
+    int reducedRow = -1;
+
+    for (int y = 0; y < rows.dstSize; y++) {
+        for (int x = 0; x < dstWidth; x++)
+            sum[x] = 0;
+
+        for (int k = 0; k < rows.count[y]; k++) {
+            const int sourceRow = rows.first[y] + k;
+            if (sourceRow != reducedRow) {
+                const uint8_t *in = src + sourceRow * srcStride;
+                for (int x = 0; x < dstWidth; x++) {
+                    const uint8_t *p = in + columns.first[x] * (bgra ? 4 : 1);
+                    const uint16_t *w = &columns.weights[columns.offset[x]];
+                    uint32_t value = 0;
+                    for (int j = 0; j < columns.count[x]; j++, p += bgra ? 4 : 1) {
+                        const uint32_t pixel = bgra ? weightB * p[0] + weightG * p[1] + weightR * p[2] : p[0];
+                        value += w[j] * pixel;
+                    }
+                    reduced[x] = bgra ? (value + 128) >> 8 : value;
+                }
+                reducedRow = sourceRow;
+            }
+
+            const uint32_t weight = rows.weights[rows.offset[y] + k];
+            for (int x = 0; x < dstWidth; x++)
+                sum[x] += weight * reduced[x];
+        }
+
+        uint8_t *out = dst + y * dstStride;
+        for (int x = 0; x < dstWidth; x++) {
+            const uint8_t luma = uint8_t((sum[x] + (1 << 15)) >> 16);
+            out[x] = luma;
+            if (histogram)
+                histogram[luma]++;
+        }
+    }
+}
+
+void LumaKernels::areaBgraToLuma(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                                 const AreaAxis &columns, const AreaAxis &rows, uint32_t *buffer, uint32_t *histogram) {
+    areaRows<true>(src, srcStride, dst, dstStride, columns, rows, buffer, histogram);
+}
+
+void LumaKernels::areaDownscaleLuma(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                                    const AreaAxis &columns, const AreaAxis &rows, uint32_t *buffer, uint32_t *histogram) {
+    areaRows<false>(src, srcStride, dst, dstStride, columns, rows, buffer, histogram);
+}
+
+#if defined(LUMA_SSE2)
+
+const char *LumaKernels::instructionSet() {
+    return "SSE2";
+}
+
+// 16 bit lanes of one channel for 8 pixels, from two registers of 4 BGRA pixels
+static inline __m128i channel16(__m128i p0, __m128i p1, int shift) {
+    const __m128i mask = _mm_set1_epi32(0xff);
+    return _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, shift), mask),
+                           _mm_and_si128(_mm_srli_epi32(p1, shift), mask));
+}
+
+// 16 luma values from 16 BGRA pixels
+static inline __m128i luma16(const uint8_t *p) {
+    const __m128i wb = _mm_set1_epi16(weightB), wg = _mm_set1_epi16(weightG), wr = _mm_set1_epi16(weightR);
+    const __m128i round = _mm_set1_epi16(128);
+    __m128i out[2];
+    for (int half = 0; half < 2; half++) {
+        __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + half * 32));
+        __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + half * 32 + 16));
+        // at most 255 * 256 + 128, fits unsigned 16 bit
+        __m128i y = _mm_add_epi16(_mm_mullo_epi16(channel16(p0, p1, 0), wb), round);
+        y = _mm_add_epi16(y, _mm_mullo_epi16(channel16(p0, p1, 8), wg));
+        y = _mm_add_epi16(y, _mm_mullo_epi16(channel16(p0, p1, 16), wr));
+        out[half] = _mm_srli_epi16(y, 8);
+    }
+    return _mm_packus_epi16(out[0], out[1]);
+}
+
+// 4 luma values from the 2x2 blocks of 8 x 2 BGRA pixels, as 32 bit lanes
+static inline __m128i luma4Half(const uint8_t *row0, const uint8_t *row1) {
+    const __m128i wb = _mm_set1_epi16(weightB), wg = _mm_set1_epi16(weightG), wr = _mm_set1_epi16(weightR);
+    __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0));
+    __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + 16));
+    __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1));
+    __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + 16));
+
+    // vertical sums in 16 bit, then madd adds horizontal neighbours and applies the weight at once
+    __m128i b = _mm_add_epi16(channel16(a0, a1, 0), channel16(b0, b1, 0));
+    __m128i g = _mm_add_epi16(channel16(a0, a1, 8), channel16(b0, b1, 8));
+    __m128i r = _mm_add_epi16(channel16(a0, a1, 16), channel16(b0, b1, 16));
+    __m128i y = _mm_add_epi32(_mm_madd_epi16(b, wb), _mm_madd_epi16(g, wg));
+    y = _mm_add_epi32(y, _mm_madd_epi16(r, wr));
+    return _mm_srli_epi32(_mm_add_epi32(y, _mm_set1_epi32(1 << 9)), 10);
+}
+
+// 4 luma values from the 4x4 blocks of 16 x 4 BGRA pixels, as 32 bit lanes
+static inline __m128i luma4x4(const uint8_t *p, int stride) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights = _mm_setr_epi16(weightB, weightG, weightR, 0, weightB, weightG, weightR, 0);
+    __m128i block[4];
+    for (int i = 0; i < 4; i++) {
+        // channel sums of 2 pixels per lane group, over the 4 rows
+        __m128i sum = zero;
+        for (int dy = 0; dy < 4; dy++) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + dy * stride + i * 16));
+            sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpackhi_epi8(a, zero)));
+        }
+        block[i] = _mm_madd_epi16(sum, weights);
+    }
+
+    // add up the 4 lanes of each block
+    __m128i t0 = _mm_add_epi32(_mm_unpacklo_epi32(block[0], block[1]), _mm_unpackhi_epi32(block[0], block[1]));
+    __m128i t1 = _mm_add_epi32(_mm_unpacklo_epi32(block[2], block[3]), _mm_unpackhi_epi32(block[2], block[3]));
+    __m128i y = _mm_add_epi32(_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1));
+    return _mm_srli_epi32(_mm_add_epi32(y, _mm_set1_epi32(1 << 11)), 12);
+}
+
+void LumaKernels::bgraToLuma(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                             int dstWidth, int dstHeight, int factor, uint32_t *histogram) {
+    if (factor != 1 && factor != 2 && factor != 4) {
+        scalarRows(src, srcStride, dst, dstStride, 0, dstWidth, dstHeight, factor, histogram);
+        return;
+    }
+
+    const int vectorWidth = dstWidth & ~15;
+    for (int y = 0; y < dstHeight; y++) {
+        const uint8_t *row0 = src + y * factor * srcStride;
+        const uint8_t *row1 = row0 + srcStride;
+        uint8_t *out = dst + y * dstStride;
+
+        for (int x = 0; x < vectorWidth; x += 16) {
+            __m128i luma;
+            if (factor == 1) {
+                luma = luma16(row0 + x * 4);
+            } else if (factor == 2) {
+                const int offset = x * 8;
+                __m128i q0 = luma4Half(row0 + offset, row1 + offset);
+                __m128i q1 = luma4Half(row0 + offset + 32, row1 + offset + 32);
+                __m128i q2 = luma4Half(row0 + offset + 64, row1 + offset + 64);
+                __m128i q3 = luma4Half(row0 + offset + 96, row1 + offset + 96);
+                luma = _mm_packus_epi16(_mm_packs_epi32(q0, q1), _mm_packs_epi32(q2, q3));
+            } else {
+                const uint8_t *block = row0 + x * 16;
+                luma = _mm_packus_epi16(_mm_packs_epi32(luma4x4(block, srcStride), luma4x4(block + 64, srcStride)),
+                                        _mm_packs_epi32(luma4x4(block + 128, srcStride), luma4x4(block + 192, srcStride)));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), luma);
+        }
+
+        if (histogram)
+            for (int x = 0; x < vectorWidth; x++)
+                histogram[out[x]]++;
+    }
+
+    if (vectorWidth < dstWidth)
+        scalarRows(src, srcStride, dst, dstStride, vectorWidth, dstWidth, dstHeight, factor, histogram);
+}
+
+// 8 averages of the 2x2 blocks of 16 x 2 luma pixels, as 16 bit lanes
+static inline __m128i average8(const uint8_t *row0, const uint8_t *row1) {
+    const __m128i even = _mm_set1_epi16(0xff);
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1));
+    __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a, even), _mm_srli_epi16(a, 8)),
+                                _mm_add_epi16(_mm_and_si128(b, even), _mm_srli_epi16(b, 8)));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+// 4 averages of the 4x4 blocks of 16 x 4 luma pixels, as 32 bit lanes
+static inline __m128i average4x4(const uint8_t *p, int stride) {
+    const __m128i even = _mm_set1_epi16(0xff);
+    __m128i sum = _mm_setzero_si128();
+    for (int dy = 0; dy < 4; dy++) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + dy * stride));
+        sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_and_si128(a, even), _mm_srli_epi16(a, 8)));
+    }
+    // neighbouring pair sums make the blocks
+    sum = _mm_madd_epi16(sum, _mm_set1_epi16(1));
+    return _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(8)), 4);
+}
+
+void LumaKernels::downscaleLuma(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                                int dstWidth, int dstHeight, int factor, uint32_t *histogram) {
+    if (factor != 2 && factor != 4) {
+        scalarLumaRows(src, srcStride, dst, dstStride, 0, dstWidth, dstHeight, factor, histogram);
+        return;
+    }
+
+    const int vectorWidth = dstWidth & ~15;
+    for (int y = 0; y < dstHeight; y++) {
+        const uint8_t *row0 = src + y * factor * srcStride;
+        const uint8_t *row1 = row0 + srcStride;
+        uint8_t *out = dst + y * dstStride;
+
+        for (int x = 0; x < vectorWidth; x += 16) {
+            __m128i luma;
+            if (factor == 2) {
+                luma = _mm_packus_epi16(average8(row0 + x * 2, row1 + x * 2),
+                                        average8(row0 + x * 2 + 16, row1 + x * 2 + 16));
+            } else {
+                const uint8_t *block = row0 + x * 4;
+                luma = _mm_packus_epi16(_mm_packs_epi32(average4x4(block, srcStride), average4x4(block + 16, srcStride)),
+                                        _mm_packs_epi32(average4x4(block + 32, srcStride), average4x4(block + 48, srcStride)));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), luma);
+        }
+
+        if (histogram)
+            for (int x = 0; x < vectorWidth; x++)
+                histogram[out[x]]++;
+    }
+
+    if (vectorWidth < dstWidth)
+        scalarLumaRows(src, srcStride, dst, dstStride, vectorWidth, dstWidth, dstHeight, factor, histogram);
+}
+
+#elif defined(LUMA_NEON)
+
+const char *LumaKernels::instructionSet() {
+    return "NEON";
+}
+
+// weighted sum of 8 pixels with 16 bit channel sums, narrowed by shift
+template <int shift>
+static inline uint8x8_t weigh8(uint16x8_t b, uint16x8_t g, uint16x8_t r) {
+    uint32x4_t lo = vmull_n_u16(vget_low_u16(b), weightB);
+    uint32x4_t hi = vmull_n_u16(vget_high_u16(b), weightB);
+    lo = vmlal_n_u16(lo, vget_low_u16(g), weightG);
+    hi = vmlal_n_u16(hi, vget_high_u16(g), weightG);
+    lo = vmlal_n_u16(lo, vget_low_u16(r), weightR);
+    hi = vmlal_n_u16(hi, vget_high_u16(r), weightR);
+    return vqmovn_u16(vcombine_u16(vrshrn_n_u32(lo, shift), vrshrn_n_u32(hi, shift)));
+}
+
+// 4 luma values from the 4x4 blocks of 16 x 4 BGRA pixels
+static inline uint16x4_t luma4x4(const uint8_t *p, int stride) {
+    uint8x16x4_t a = vld4q_u8(p);
+    uint16x8_t b = vpaddlq_u8(a.val[0]), g = vpaddlq_u8(a.val[1]), r = vpaddlq_u8(a.val[2]);
+    for (int dy = 1; dy < 4; dy++) {
+        a = vld4q_u8(p + dy * stride);
+        b = vpadalq_u8(b, a.val[0]);
+        g = vpadalq_u8(g, a.val[1]);
+        r = vpadalq_u8(r, a.val[2]);
+    }
+    uint32x4_t y = vmulq_n_u32(vpaddlq_u16(b), weightB);
+    y = vmlaq_n_u32(y, vpaddlq_u16(g), weightG);
+    y = vmlaq_n_u32(y, vpaddlq_u16(r), weightR);
+    return vrshrn_n_u32(y, 12);
+}
+
+void LumaKernels::bgraToLuma(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                             int dstWidth, int dstHeight, int factor, uint32_t *histogram) {
+    if (factor != 1 && factor != 2 && factor != 4) {
+        scalarRows(src, srcStride, dst, dstStride, 0, dstWidth, dstHeight, factor, histogram);
+        return;
+    }
+
+    const int vectorWidth = dstWidth & ~7;
+    for (int y = 0; y < dstHeight; y++) {
+        const uint8_t *row0 = src + y * factor * srcStride;
+        const uint8_t *row1 = row0 + srcStride;
+        uint8_t *out = dst + y * dstStride;
+
+        for (int x = 0; x < vectorWidth; x += 8) {
+            uint8x8_t luma;
+            if (factor == 1) {
+                uint8x8x4_t p = vld4_u8(row0 + x * 4); // deinterleaves B, G, R, A
+                luma = weigh8<8>(vmovl_u8(p.val[0]), vmovl_u8(p.val[1]), vmovl_u8(p.val[2]));
+            } else if (factor == 4) {
+                luma = vqmovn_u16(vcombine_u16(luma4x4(row0 + x * 16, srcStride), luma4x4(row0 + x * 16 + 64, srcStride)));
+            } else {
+                uint8x16x4_t a = vld4q_u8(row0 + x * 8);
+                uint8x16x4_t b = vld4q_u8(row1 + x * 8);
+                // horizontal pairs, then the second row
+                uint16x8_t sb = vpadalq_u8(vpaddlq_u8(a.val[0]), b.val[0]);
+                uint16x8_t sg = vpadalq_u8(vpaddlq_u8(a.val[1]), b.val[1]);
+                uint16x8_t sr = vpadalq_u8(vpaddlq_u8(a.val[2]), b.val[2]);
+                luma = weigh8<10>(sb, sg, sr);
+            }
+            vst1_u8(out + x, luma);
+        }
+
+        if (histogram)
+            for (int x = 0; x < vectorWidth; x++)
+                histogram[out[x]]++;
+    }
+
+    if (vectorWidth < dstWidth)
+        scalarRows(src, srcStride, dst, dstStride, vectorWidth, dstWidth, dstHeight, factor, histogram);
+}
+
+// 4 averages of the 4x4 blocks of 16 x 4 luma pixels
+static inline uint16x4_t average4x4(const uint8_t *p, int stride) {
+    uint16x8_t sum = vpaddlq_u8(vld1q_u8(p));
+    for (int dy = 1; dy < 4; dy++)
+        sum = vpadalq_u8(sum, vld1q_u8(p + dy * stride));
+    return vrshrn_n_u32(vpaddlq_u16(sum), 4);
+}
+
+void LumaKernels::downscaleLuma(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                                int dstWidth, int dstHeight, int factor, uint32_t *histogram) {
+    if (factor != 2 && factor != 4) {
+        scalarLumaRows(src, srcStride, dst, dstStride, 0, dstWidth, dstHeight, factor, histogram);
+        return;
+    }
+
+    const int vectorWidth = dstWidth & ~7;
+    for (int y = 0; y < dstHeight; y++) {
+        const uint8_t *row0 = src + y * factor * srcStride;
+        const uint8_t *row1 = row0 + srcStride;
+        uint8_t *out = dst + y * dstStride;
+
+        for (int x = 0; x < vectorWidth; x += 8) {
+            if (factor == 4) {
+                vst1_u8(out + x, vqmovn_u16(vcombine_u16(average4x4(row0 + x * 4, srcStride),
+                                                         average4x4(row0 + x * 4 + 16, srcStride))));
+                continue;
+            }
+            // horizontal pairs of the first row, plus those of the second row, rounded /4
+            uint16x8_t sum = vpadalq_u8(vpaddlq_u8(vld1q_u8(row0 + x * 2)), vld1q_u8(row1 + x * 2));
+            vst1_u8(out + x, vrshrn_n_u16(sum, 2));
+        }
+
+        if (histogram)
+            for (int x = 0; x < vectorWidth; x++)
+                histogram[out[x]]++;
+    }
+
+    if (vectorWidth < dstWidth)
+        scalarLumaRows(src, srcStride, dst, dstStride, vectorWidth, dstWidth, dstHeight, factor, histogram);
+}
+
+#else
+
+const char *LumaKernels::instructionSet() {
+    return "scalar";
+}
+
+void LumaKernels::downscaleLuma(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                                int dstWidth, int dstHeight, int factor, uint32_t *histogram) {
+    scalarLumaRows(src, srcStride, dst, dstStride, 0, dstWidth, dstHeight, factor, histogram);
+}
+
+void LumaKernels::bgraToLuma(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                             int dstWidth, int dstHeight, int factor, uint32_t *histogram) {
+    scalarRows(src, srcStride, dst, dstStride, 0, dstWidth, dstHeight, factor, histogram);
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef LUMAKERNELS_H
+#define LUMAKERNELS_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Fused preprocessing kernels: BGRA (or luma) to 8 bit luma and box downscale in one pass over the source, with the
+ * histogram of the output gathered on the way so equalization only needs a lookup table afterwards.
+ * SSE2 on x86, NEON on ARM, scalar everywhere else. Sizes that are not 1, 2 or 4 times the output go through the
+ * area kernels, which take any ratio.
+ */
+namespace LumaKernels {
+
+// factor is 1, 2 or 4; dst is dstWidth x dstHeight, the source is factor times bigger; histogram may be null
+void bgraToLuma(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                int dstWidth, int dstHeight, int factor, uint32_t *histogram);
+
+// reference implementation, the vector paths must give the exact same bytes
+void bgraToLumaScalar(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                      int dstWidth, int dstHeight, int factor, uint32_t *histogram);
+
+// same for an 8 bit luma source (the Y plane of YUV cameras)
+void downscaleLuma(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                   int dstWidth, int dstHeight, int factor, uint32_t *histogram);
+
+void downscaleLumaScalar(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                         int dstWidth, int dstHeight, int factor, uint32_t *histogram);
+
+/**
+ * @brief The AreaAxis struct : area (INTER_AREA) weights of one axis for any downscale ratio. Output i averages the
+ * sources [first[i], first[i] + count[i]) with 8 bit fixed point weights that add up to 256.
+ * Built when the sizes change, the kernels only read it.
+ */
+struct AreaAxis
+{
+    int srcSize = 0;
+    int dstSize = 0;
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<int> offset;        // where the weights of each output start
+    std::vector<uint16_t> weights;
+
+    void build(int srcSize, int dstSize);
+};
+
+// dst is columns.dstSize x rows.dstSize, no bigger than the source on either axis; buffer holds 2 * columns.dstSize
+// values and is kept by the caller so nothing is allocated per frame; histogram may be null
+void areaBgraToLuma(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                    const AreaAxis &columns, const AreaAxis &rows, uint32_t *buffer, uint32_t *histogram);
+
+void areaDownscaleLuma(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                       const AreaAxis &columns, const AreaAxis &rows, uint32_t *buffer, uint32_t *histogram);
+
+const char *instructionSet();
+
+}
+
+#endif // LUMAKERNELS_H
@@ -1,7 +1,13 @@
 #include <QApplication>
+#include <QDebug>
+#include <QOpenGLContext>
 #include <QQmlApplicationEngine>
+#include <QQmlContext>
+#include "cameraframesource.h"
 #include "facefeaturedetector.h"
 #include "glperspectivescene.h"
+#include "hotpathtrace.h"
+#include <memory>
 
 int main(int argc, char *argv[])
 {
@@ -14,8 +20,6 @@ int main(int argc, char *argv[])
     app.setApplicationName("Head Coupled Display");
     app.setApplicationVersion("1.0");
 
-    FaceFeatureDetector *detector = new FaceFeatureDetector(imageWidth, imageHeight);
-
     QQmlApplicationEngine engine;
 
     engine.rootContext()->setContextProperty("w", imageWidth);
@@ -29,10 +33,60 @@ int main(int argc, char *argv[])
     }, Qt::QueuedConnection);
     engine.load(url);
 
-    detector->start(engine.rootObjects().first()); //start processing
+    // camera is rotated FOR MY DEVICE (Huawei p20). It may or may not be for yours.
+    // Testing is required to verify this. try -180, -90, 0, 90, 180...etc to see what works
+    QObject *camera = engine.rootObjects().first()->findChild<QObject *>("camera");
+    CameraFrameSource cameraSource(camera, -90);
+
+    // Declared after the frame source and before the scene: it is destroyed after the scene that reads it and
+    // stops the source and its detection thread before the source goes away
+    std::unique_ptr<FaceFeatureDetector> detector(new FaceFeatureDetector(imageWidth, imageHeight));
+
+    // HCP_DETECTOR=haar|lbp|dnn and HCP_DETECTOR_MODEL=<face model> pick the detector backend for this device
+    // HCP_DETECTION_BUDGET_MS=<ms> lets the detection adapt its resolution and rate to hold that budget
+    TrackingSettings tracking;
+    bool customTracking = false;
+    if (FaceDetectorBackend::parseKind(qEnvironmentVariable("HCP_DETECTOR"), tracking.detector)) {
+        tracking.detectorModel = qEnvironmentVariable("HCP_DETECTOR_MODEL");
+        customTracking = true;
+    }
+    float budgetMs = qEnvironmentVariable("HCP_DETECTION_BUDGET_MS").toFloat();
+    if (budgetMs > 0.0f) {
+        tracking.adaptiveDetection = true;
+        tracking.latencyBudgetMs = budgetMs;
+        customTracking = true;
+    }
+    if (customTracking)
+        detector->setTrackingSettings(tracking);
+
+    detector->start(&cameraSource); //start processing
+
+    glPerspectiveScene scene(detector.get());
+
+    // The objects of each mesh, and both eyes in stereo, are drawn by instanced draws: GLES 3 or OpenGL 3.3
+    QSurfaceFormat format = scene.requestedFormat();
+    if (QOpenGLContext::openGLModuleType() == QOpenGLContext::LibGLES) {
+        format.setVersion(3, 0);
+    } else {
+        format.setVersion(3, 3);
+        format.setProfile(QSurfaceFormat::CompatibilityProfile);
+    }
+    scene.setFormat(format);
+
+    // HCP_STEREO=sbs : a view for each eye side by side, for autostereo and side by side displays
+    if (qEnvironmentVariable("HCP_STEREO") == "sbs")
+        scene.setStereoMode(glPerspectiveScene::SideBySide);
 
-    glPerspectiveScene scene(detector);
     scene.show();
 
-    return app.exec();
+    int status = app.exec();
+
+    qDebug().nospace() << "frames rendered: " << scene.getRenderedFrames() << ", skipped: " << scene.getSkippedFrames();
+
+    // HCP_TRACE_FILE=trace.json : dump the hot path samples for chrome://tracing or Perfetto
+    const QString traceFile = qEnvironmentVariable("HCP_TRACE_FILE");
+    if (!traceFile.isEmpty() && !HotPathTrace::writeChromeTrace(traceFile))
+        qDebug() << "could not write trace to" << traceFile;
+
+    return status;
 }
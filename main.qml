@@ -9,11 +9,10 @@ Window {
 //    width: 1080 //change for your screen
 //    height: 2280 //change for your screen
 
-    signal frameReady(var frame)
-
     Camera
     {
         id: camera
+        objectName: "camera"
 //        captureMode: Camera.CaptureViewfinder
         position: Camera.FrontFace
 
@@ -26,23 +25,12 @@ Window {
 //        }
     }
 
+    // Frames are read straight from the camera buffers in C++ (CameraFrameSource),
+    // the output only keeps the viewfinder running
     VideoOutput
     {
         id: videoOutput
         source: camera
-
-        // camera is rotated FOR MY DEVICE (Huawei p20). It may or may not be for yours.
-        // Testing is required to verify this. try -180, -90, 0, 90, 180...etc to see what works
-        orientation: -90
-
         visible: false
     }
-
-    //function called to send a frame to C++
-    function grab()
-    {
-        videoOutput.grabToImage(function(frame) {
-            frameReady(frame) //Emit frameReady SIGNAL
-        }, Qt.size(w, h))
-    }
 }
@@ -0,0 +1,105 @@
+#include "meshfile.h"
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <algorithm>
+
+/**
+ * @brief MeshData::computeBounds : center the bounding sphere on the box around the vertices
+ */
+void MeshData::computeBounds() {
+    if (vertices.isEmpty()) {
+        center = QVector3D();
+        radius = 0.0f;
+        return;
+    }
+
+    QVector3D low = vertices[0].position, high = low;
+    for (const MeshVertex &vertex : vertices) {
+        const QVector3D &p = vertex.position;
+        low = QVector3D(std::min(low.x(), p.x()), std::min(low.y(), p.y()), std::min(low.z(), p.z()));
+        high = QVector3D(std::max(high.x(), p.x()), std::max(high.y(), p.y()), std::max(high.z(), p.z()));
+    }
+
+    center = (low + high) / 2.0f;
+    radius = 0.0f;
+    for (const MeshVertex &vertex : vertices)
+        radius = std::max(radius, (vertex.position - center).length());
+}
+
+/**
+ * @brief MeshFile::read : parse an OBJ file held in memory, polygons are split into triangle fans
+ * @param data : the file
+ * @param mesh : receives the mesh
+ * @return false if a face refers to a missing vertex, or the mesh is empty or has more than 65536 vertices
+ */
+bool MeshFile::read(const QByteArray &data, MeshData &mesh) {
+    mesh = MeshData();
+    QVector<QVector3D> positions;
+    QVector<QVector2D> textureCoords;
+    QHash<QPair<int, int>, int> vertexOf; //OBJ indexes positions and texture coordinates separately
+
+    const QList<QByteArray> lines = data.split('\n');
+    for (int number = 0; number < lines.size(); number++) {
+        const QList<QByteArray> fields = lines[number].simplified().split(' ');
+        const QByteArray &type = fields[0];
+
+        if (type == "v" && fields.size() >= 4) {
+            positions.append(QVector3D(fields[1].toFloat(), fields[2].toFloat(), fields[3].toFloat()));
+        } else if (type == "vt" && fields.size() >= 3) {
+            textureCoords.append(QVector2D(fields[1].toFloat(), fields[2].toFloat()));
+        } else if (type == "f" && fields.size() >= 4) {
+            QVector<int> face;
+            for (int i = 1; i < fields.size(); i++) {
+                //v, v/vt, v/vt/vn or v//vn, negative indices count back from the last one
+                const QList<QByteArray> refs = fields[i].split('/');
+                int position = refs[0].toInt(), textureCoord = refs.size() > 1 ? refs[1].toInt() : 0;
+                position = position < 0 ? positions.size() + position : position - 1;
+                textureCoord = textureCoord < 0 ? textureCoords.size() + textureCoord : textureCoord - 1;
+                if (position < 0 || position >= positions.size() || textureCoord >= textureCoords.size()) {
+                    qDebug() << "OBJ face refers to a missing vertex on line" << number + 1;
+                    return false;
+                }
+
+                const QPair<int, int> key(position, textureCoord);
+                int vertex = vertexOf.value(key, -1);
+                if (vertex < 0) {
+                    vertex = mesh.vertices.size();
+                    vertexOf.insert(key, vertex);
+                    mesh.vertices.append({positions[position], textureCoord >= 0 ? textureCoords[textureCoord] : QVector2D()});
+                }
+                face.append(vertex);
+            }
+
+            for (int i = 2; i < face.size(); i++)
+                mesh.indices << quint16(face[0]) << quint16(face[i - 1]) << quint16(face[i]);
+        }
+    }
+
+    if (mesh.vertices.size() > 65536) {
+        qDebug() << "OBJ mesh has" << mesh.vertices.size() << "vertices, 16 bit indices reach 65536";
+        return false;
+    }
+    mesh.computeBounds();
+    return !mesh.isEmpty();
+}
+
+/**
+ * @brief MeshFile::read : parse an OBJ file, resource or file
+ * @param path
+ * @param mesh : receives the mesh
+ * @return false if the file can't be read or parsed
+ */
+bool MeshFile::read(const QString &path, MeshData &mesh) {
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly)) {
+        qDebug() << "Can't read mesh" << path;
+        return false;
+    }
+    if (!read(file.readAll(), mesh)) {
+        qDebug() << "Can't parse mesh" << path;
+        return false;
+    }
+    return true;
+}
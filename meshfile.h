@@ -0,0 +1,43 @@
+#ifndef MESHFILE_H
+#define MESHFILE_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QVector2D>
+#include <QVector3D>
+
+/**
+ * @brief The MeshVertex struct : one vertex as the shaders read it
+ */
+struct MeshVertex
+{
+    QVector3D position;
+    QVector2D textureCoord;
+};
+
+/**
+ * @brief The MeshData struct : an indexed triangle list with the sphere bounding it
+ */
+struct MeshData
+{
+    QVector<MeshVertex> vertices;
+    QVector<quint16> indices;   // three per triangle
+    QVector3D center;
+    float radius = 0.0f;
+
+    bool isEmpty() const { return indices.isEmpty(); }
+    void computeBounds();
+};
+
+/**
+ * @brief The MeshFile class : reads meshes from Wavefront OBJ files, positions and texture coordinates of
+ * polygon faces. Normals, materials and groups are ignored.
+ */
+class MeshFile
+{
+public:
+    static bool read(const QByteArray &data, MeshData &mesh);
+    static bool read(const QString &path, MeshData &mesh);
+};
+
+#endif // MESHFILE_H
@@ -0,0 +1,16 @@
+#ifndef MONOTONICCLOCK_H
+#define MONOTONICCLOCK_H
+
+#include <QtGlobal>
+#include <chrono>
+
+/**
+ * @brief monotonicNs : the clock every frame, pose and trace timestamp is taken from
+ * @return nanoseconds on the steady clock
+ */
+inline qint64 monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif // MONOTONICCLOCK_H
@@ -0,0 +1,77 @@
+#include "motiongate.h"
+#include <opencv2/imgproc.hpp>
+
+static const cv::Size thumbnailSize(32, 32);
+static const float regionMargin = 0.25f; // the face grown by this fraction on each side, head motion shows at its edges
+
+/**
+ * @brief MotionGate::reset : forget the reference, the next frame is detected
+ */
+void MotionGate::reset() {
+    reference.release();
+    gatedFrames = 0;
+}
+
+/**
+ * @brief MotionGate::setThreshold
+ * @param meanDifference : mean absolute difference of the thumbnails, in gray levels, under which a frame is static
+ */
+void MotionGate::setThreshold(float meanDifference) {
+    threshold = meanDifference;
+}
+
+/**
+ * @brief MotionGate::setMaxGatedFrames : a detection runs at least every this many frames, even in a static scene
+ * @param frames
+ */
+void MotionGate::setMaxGatedFrames(int frames) {
+    maxGatedFrames = frames;
+}
+
+/**
+ * @brief MotionGate::setReference : remember the frame a detection just ran on
+ * @param gray : the detected frame
+ * @param face : the face found in it, empty when there was none
+ */
+void MotionGate::setReference(const cv::Mat &gray, const cv::Rect &face) {
+    frameSize = gray.size();
+    region = cv::Rect(0, 0, gray.cols, gray.rows);
+    if (!face.empty()) {
+        int marginX = cvRound(face.width * regionMargin);
+        int marginY = cvRound(face.height * regionMargin);
+        region &= cv::Rect(face.x - marginX, face.y - marginY, face.width + 2 * marginX, face.height + 2 * marginY);
+    }
+    sample(gray, reference);
+    gatedFrames = 0;
+}
+
+/**
+ * @brief MotionGate::isStatic : compare a frame to the reference
+ * @param gray : frame about to be detected, same size as the reference
+ * @return true if the previous result still holds and the detection can be skipped
+ */
+bool MotionGate::isStatic(const cv::Mat &gray) {
+    if (reference.empty() || gray.size() != frameSize || gatedFrames >= maxGatedFrames)
+        return false;
+
+    sample(gray, current);
+    cv::absdiff(current, reference, difference);
+    lastDifference = float(cv::mean(difference)[0]);
+    if (lastDifference >= threshold)
+        return false;
+
+    gatedFrames++;
+    return true;
+}
+
+/**
+ * @brief MotionGate::getLastDifference
+ * @return mean difference of the last compared frame, in gray levels
+ */
+float MotionGate::getLastDifference() const {
+    return lastDifference;
+}
+
+void MotionGate::sample(const cv::Mat &gray, cv::Mat &thumbnail) {
+    cv::resize(gray(region), thumbnail, thumbnailSize, 0, 0, cv::INTER_AREA);
+}
@@ -0,0 +1,38 @@
+#ifndef MOTIONGATE_H
+#define MOTIONGATE_H
+
+#include <opencv2/core.hpp>
+
+/**
+ * @brief The MotionGate class : tells when a frame is close enough to the last detected one that the detection can be
+ * skipped. Compares a small area averaged thumbnail of the face (or of the whole frame when there is no face), so camera
+ * noise averages out and the check costs a fraction of a cascade run.
+ */
+class MotionGate
+{
+public:
+    void reset();
+    void setThreshold(float meanDifference);
+    void setMaxGatedFrames(int frames);
+
+    void setReference(const cv::Mat &gray, const cv::Rect &face);
+    bool isStatic(const cv::Mat &gray);
+    float getLastDifference() const;
+
+private:
+    void sample(const cv::Mat &gray, cv::Mat &thumbnail);
+
+private:
+    cv::Mat reference;
+    cv::Mat current;
+    cv::Mat difference;
+    cv::Rect region;
+    cv::Size frameSize;
+
+    float threshold = 2.0f;
+    int maxGatedFrames = 30;
+    int gatedFrames = 0;
+    float lastDifference = 0.0f;
+};
+
+#endif // MOTIONGATE_H
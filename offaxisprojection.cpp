@@ -0,0 +1,117 @@
+#include "offaxisprojection.h"
+#include <cstring>
+
+OffAxisProjection::OffAxisProjection()
+{
+    setScreen(QVector3D(-1.0f, -1.0f, 0.0f), QVector3D(1.0f, -1.0f, 0.0f), QVector3D(-1.0f, 1.0f, 0.0f));
+}
+
+/**
+ * @brief OffAxisProjection::setScreen : cache the screen basis, only needed when the screen changes (resize)
+ * @param pa : lower left corner
+ * @param pb : lower right corner
+ * @param pc : upper left corner
+ */
+void OffAxisProjection::setScreen(const QVector3D &pa, const QVector3D &pb, const QVector3D &pc)
+{
+    vr = pb - pa;
+    vu = pc - pa;
+    width = vr.length();
+    height = vu.length();
+    vr.normalize();
+    vu.normalize();
+    vn = QVector3D::crossProduct(vr, vu);
+    vn.normalize();
+
+    paR = QVector3D::dotProduct(vr, pa);
+    paU = QVector3D::dotProduct(vu, pa);
+    paN = QVector3D::dotProduct(vn, pa);
+}
+
+/**
+ * @brief OffAxisProjection::matrix : frustum * screen rotation * eye translation, written out element by element
+ * @param pe : eye position
+ * @param n : near plane distance
+ * @param f : far plane distance
+ * @return the projection matrix, same as projFrustum() for the cached screen
+ */
+QMatrix4x4 OffAxisProjection::matrix(const QVector3D &pe, float n, float f) const
+{
+    // Eye in the screen basis, and its distance to the screen plane
+    const float er = QVector3D::dotProduct(vr, pe);
+    const float eu = QVector3D::dotProduct(vu, pe);
+    const float en = QVector3D::dotProduct(vn, pe);
+    const float d = en - paN;
+
+    // glFrustum terms with l, r, b, t = extent of the screen seen from the eye, scaled to the near plane.
+    // The near plane distance cancels out of all but the depth terms.
+    const float sx = 2.0f * d / width;
+    const float sy = 2.0f * d / height;
+    const float ox = (2.0f * (paR - er) + width) / width;
+    const float oy = (2.0f * (paU - eu) + height) / height;
+    const float zz = -(f + n) / (f - n);
+    const float zw = -2.0f * f * n / (f - n);
+
+    // Rows of the rotation to the screen basis with the eye translation folded in: (v, -v.pe)
+    return QMatrix4x4(
+            sx * vr.x() + ox * vn.x(), sx * vr.y() + ox * vn.y(), sx * vr.z() + ox * vn.z(), -sx * er - ox * en,
+            sy * vu.x() + oy * vn.x(), sy * vu.y() + oy * vn.y(), sy * vu.z() + oy * vn.z(), -sy * eu - oy * en,
+            zz * vn.x(), zz * vn.y(), zz * vn.z(), -zz * en + zw,
+            -vn.x(), -vn.y(), -vn.z(), en);
+}
+
+/**
+ * @brief OffAxisProjection::projFrustum : the general construction, every term computed from the corners.
+ * Kept as the reference matrix() is checked against (bench/projectionbench).
+ */
+QMatrix4x4 OffAxisProjection::projFrustum(
+        const QVector3D pa,
+        const QVector3D pb,
+        const QVector3D pc,
+        const QVector3D pe,
+        float n, float f)
+{
+    QVector3D va, vb, vc;
+    QVector3D vr, vu, vn;
+
+    QMatrix4x4 frustum;
+
+    float l, r, b, t, d, M[16];
+
+    // Compute an orthonormal basis for the screen.
+    vr = pb - pa; 
+    vu = pc - pa; 
+    vr.normalize(); 
+    vu.normalize(); 
+    vn = QVector3D::crossProduct(vr, vu); 
+    vn.normalize(); 
+
+    // Compute the screen corner vectors.
+    va = pa - pe; 
+    vb = pb - pe; 
+    vc = pc - pe; 
+
+    // Find the distance from the eye to screen plane.
+    d = -QVector3D::dotProduct(va, vn); 
+
+    // Find the extent of the perpendicular projection.
+    l = QVector3D::dotProduct(vr, va) * n / d; 
+    r = QVector3D::dotProduct(vr, vb) * n / d; 
+    b = QVector3D::dotProduct(vu, va) * n / d; 
+    t = QVector3D::dotProduct(vu, vc) * n / d; 
+
+    // Rotate the projection to be non-perpendicular.
+    memset(M, 0, 16 * sizeof(float));
+    M[0] = vr.x(); M[4] = vr.y(); M[ 8] = vr.z();
+    M[1] = vu.x(); M[5] = vu.y(); M[ 9] = vu.z();
+    M[2] = vn.x(); M[6] = vn.y(); M[10] = vn.z();
+    M[15] = 1.0f;
+
+    frustum.frustum(l, r, b, t, n, f); 
+    frustum = frustum * QMatrix4x4(M);
+
+    // Move the apex of the frustum to the origin.
+    frustum.translate(-pe);
+
+    return frustum;
+}
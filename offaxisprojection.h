@@ -0,0 +1,33 @@
+#ifndef OFFAXISPROJECTION_H
+#define OFFAXISPROJECTION_H
+
+#include <QMatrix4x4>
+#include <QVector3D>
+
+/**
+ * @brief The OffAxisProjection class : the projection of a screen rectangle seen from an eye in front of it
+ * (generalized perspective projection, R. Kooima). Everything that depends only on the screen is computed once
+ * in setScreen(), matrix() is then a closed form of the eye position.
+ */
+class OffAxisProjection
+{
+public:
+    OffAxisProjection();
+
+    void setScreen(const QVector3D &pa, const QVector3D &pb, const QVector3D &pc);
+    QMatrix4x4 matrix(const QVector3D &pe, float n, float f) const;
+
+    static QMatrix4x4 projFrustum(
+            const QVector3D pa,
+            const QVector3D pb,
+            const QVector3D pc,
+            const QVector3D pe,
+            float n, float f);
+
+private:
+    QVector3D vr, vu, vn;       // orthonormal basis of the screen
+    float paR, paU, paN;        // lower left corner in that basis
+    float width, height;        // screen extent along vr and vu
+};
+
+#endif // OFFAXISPROJECTION_H
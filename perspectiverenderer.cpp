@@ -0,0 +1,724 @@
+#include "perspectiverenderer.h"
+#include <QDebug>
+#include <QColor>
+#include <QImage>
+#include <QOpenGLContext>
+#include "monotonicclock.h"
+
+// Not in the GLES 3.0 headers, GL_CLIP_DISTANCE0_EXT of GL_EXT_clip_cull_distance has the same value
+#ifndef GL_CLIP_DISTANCE0
+#define GL_CLIP_DISTANCE0 0x3000
+#endif
+
+static const char *defaultSceneFile = ":/scene.json";
+
+PerspectiveRenderer::PerspectiveRenderer() :
+    vertexArena(QOpenGLBuffer::VertexBuffer),
+    indexArena(QOpenGLBuffer::IndexBuffer),
+    instanceBuffer(QOpenGLBuffer::VertexBuffer)
+{
+    resize(1, 1);
+}
+
+PerspectiveRenderer::~PerspectiveRenderer()
+{
+    destroy();
+}
+
+/**
+ * @brief PerspectiveRenderer::loadScene : replace the scene, before initialize()
+ * @param path : JSON scene description, see Scene::load()
+ * @return false if it can't be loaded
+ */
+bool PerspectiveRenderer::loadScene(const QString &path)
+{
+    if (!scene.load(path))
+        return false;
+    scene.setScreenSize(sceneWidth, sceneHeight);
+    return true;
+}
+
+/**
+ * @brief PerspectiveRenderer::getScene
+ * @return the scene, meshes are added before initialize() and objects at any time
+ */
+Scene &PerspectiveRenderer::getScene()
+{
+    return scene;
+}
+
+/**
+ * @brief PerspectiveRenderer::setInstancing
+ * @param enabled : false draws every object on its own even where the context has instancing, before initialize()
+ */
+void PerspectiveRenderer::setInstancing(bool enabled)
+{
+    instancing = enabled;
+}
+
+/**
+ * @brief PerspectiveRenderer::initialize : compile the shaders, start loading the textures and create the buffers,
+ * the context of the target surface must be current. The default scene is loaded if none was. The textures
+ * arrive in later frames.
+ * @return false if the shaders could not be built or the scene could not be loaded
+ */
+bool PerspectiveRenderer::initialize()
+{
+    initializeOpenGLFunctions();
+    initialized = true;
+
+    glClearColor(0, 0, 0, 1);
+
+    if (scene.getBatches().empty() && !loadScene(defaultSceneFile))
+        return false;
+
+    if (!initShaders())
+        return false;
+    loadTextures();
+
+    // Enable depth buffer
+    glEnable(GL_DEPTH_TEST);
+
+    // Enable back face culling
+    glEnable(GL_CULL_FACE);
+
+    return uploadGeometry();
+}
+
+/**
+ * @brief PerspectiveRenderer::destroy : free the GL resources, the context they were created in must be current
+ */
+void PerspectiveRenderer::destroy()
+{
+    if (!initialized)
+        return;
+    initialized = false;
+
+    vao.destroy();
+    vertexArena.destroy();
+    indexArena.destroy();
+    instanceBuffer.destroy();
+
+    //a load still running finishes into the loader, the next initialize() asks again
+    textureLoader.waitForDone();
+    TextureData unused;
+    for (const Scene::Batch &batch : scene.getBatches())
+        textureLoader.take(batch.texture, unused);
+    texturesPending = false;
+
+    qDeleteAll(textures);
+    textures.clear();
+    batchTextures.clear();
+    delete placeholderTexture;
+    placeholderTexture = nullptr;
+
+    program.removeAllShaders();
+    instancedProgram.removeAllShaders();
+    stereoProgram.removeAllShaders();
+    instanced = stereoInitialized = stereoInstanced = false;
+    instanceDivisor = 0;
+    activeProgram = nullptr;
+}
+
+/**
+ * @brief PerspectiveRenderer::initShaders : build the programs, from the binary cache when the driver allows it.
+ * The instanced program is only built where the context has instanced draws.
+ * @return false if they could not be built
+ */
+bool PerspectiveRenderer::initShaders()
+{
+    // Every program reads the geometry through the same vertex array object, so the same attribute locations
+    program.bindAttributeLocation("aPosition", vertexLocation);
+    program.bindAttributeLocation("aTexCoord", texcoordLocation);
+    if (!ShaderCache::build(program, "scene", ":/vshader.glsl", ":/fshader.glsl", &shaderReport))
+        return false;
+
+    if (!shaderReport.binarySupported)
+        qDebug().nospace() << "Shaders compiled in " << shaderReport.compileMs << " ms, no program binaries on this driver";
+    else if (shaderReport.cacheHit)
+        qDebug().nospace() << "Shaders loaded from the cache in " << shaderReport.loadMs << " ms";
+    else
+        qDebug().nospace() << "Shader cache miss: compiled in " << shaderReport.compileMs << " ms, stored in "
+                           << shaderReport.storeMs << " ms (" << shaderReport.loadMs << " ms checking the cache)";
+    mvpLocation = program.uniformLocation("mvp");
+
+    instanced = instancing && initInstancedShaders(instancedProgram, "instanced", QByteArray());
+    viewProjectionLocation = instanced ? instancedProgram.uniformLocation("viewProjection") : -1;
+
+    // Bind shader pipeline for use
+    QOpenGLShaderProgram &first = instanced ? instancedProgram : program;
+    if (!first.bind()) {
+        qDebug() <<  "\nBINDING ERROR\n";
+        return false;
+    }
+    activeProgram = &first;
+    return true;
+}
+
+/**
+ * @brief PerspectiveRenderer::initInstancedShaders : build a program of the instanced shaders
+ * @param target
+ * @param name : names its cache file
+ * @param defines : put before the sources, after the #version line
+ * @return false where the context has no instanced draws (GLES 3, OpenGL 3.3) or the program fails
+ */
+bool PerspectiveRenderer::initInstancedShaders(QOpenGLShaderProgram &target, const QString &name, const QByteArray &defines)
+{
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    const QSurfaceFormat format = context->format();
+    QByteArray version;
+    if (context->isOpenGLES() && format.majorVersion() >= 3)
+        version = "#version 300 es\n";
+    else if (!context->isOpenGLES() && format.version() >= qMakePair(3, 3))
+        version = "#version 330\n";
+    else {
+        qDebug().nospace() << "No instanced draws on OpenGL " << format.majorVersion() << "." << format.minorVersion()
+                           << ", every object is drawn on its own";
+        return false;
+    }
+
+    target.bindAttributeLocation("aPosition", vertexLocation);
+    target.bindAttributeLocation("aTexCoord", texcoordLocation);
+    for (int row = 0; row < 3; row++)
+        target.bindAttributeLocation(QByteArray("aModel") + char('0' + row), modelLocation + row);
+
+    ShaderCache::Report report;
+    if (!ShaderCache::build(target, name, ":/vshader_instanced.glsl", ":/fshader_instanced.glsl", &report, version + defines)) {
+        qDebug() << "Instanced shaders failed, every object is drawn on its own";
+        return false;
+    }
+    qDebug().nospace() << "Shaders " << name << (report.cacheHit ? " loaded from the cache in " : " compiled in ")
+                       << (report.cacheHit ? report.loadMs : report.compileMs) << " ms";
+
+    extraFunctions = context->extraFunctions();
+    return true;
+}
+
+/**
+ * @brief PerspectiveRenderer::initializeStereo : build the program drawing both eyes in the same instanced draws,
+ * renderStereo() calls it on its first frame. Done once per initialize().
+ * It clips each eye to its half of the target with clip distances, core in OpenGL 3.3 and an extension on GLES.
+ * Without them each eye is drawn in its own pass into its own viewport.
+ * @return true if stereo is single pass, false if this context draws each eye separately
+ */
+bool PerspectiveRenderer::initializeStereo()
+{
+    if (stereoInitialized)
+        return stereoInstanced;
+    stereoInitialized = true;
+    if (!instanced)
+        return false;
+
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    QByteArray defines = "#define STEREO\n";
+    if (context->isOpenGLES()) {
+        if (!context->hasExtension("GL_EXT_clip_cull_distance")) {
+            qDebug() << "No clip distances on this GLES context, each eye is drawn in its own pass";
+            return false;
+        }
+        defines.prepend("#extension GL_EXT_clip_cull_distance : require\n");
+    }
+
+    stereoInstanced = initInstancedShaders(stereoProgram, "instanced-stereo", defines);
+    stereoViewProjectionLocation = stereoInstanced ? stereoProgram.uniformLocation("viewProjection") : -1;
+    return stereoInstanced;
+}
+
+/**
+ * @brief PerspectiveRenderer::useProgram : bind a program unless it already is
+ * @param next
+ */
+void PerspectiveRenderer::useProgram(QOpenGLShaderProgram &next)
+{
+    if (activeProgram == &next)
+        return;
+    next.bind();
+    activeProgram = &next;
+    countState();
+}
+
+/**
+ * @brief PerspectiveRenderer::loadTextures : tell the loader which compressed formats this context samples and
+ * start decoding the texture of every mesh, nothing waits for it here
+ */
+void PerspectiveRenderer::loadTextures()
+{
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    QVector<quint32> formats;
+    if ((context->isOpenGLES() && context->format().majorVersion() >= 3) || context->hasExtension("GL_ARB_ES3_compatibility"))
+        formats << 0x9274 << 0x9278; // GL_COMPRESSED_RGB8_ETC2, GL_COMPRESSED_RGBA8_ETC2_EAC
+    if (context->hasExtension("GL_KHR_texture_compression_astc_ldr"))
+        for (quint32 format = 0x93B0; format <= 0x93BD; format++) // GL_COMPRESSED_RGBA_ASTC_4x4 to 12x12
+            formats << format;
+    if (context->hasExtension("GL_OES_compressed_ETC1_RGB8_texture"))
+        formats << 0x8D64; // GL_ETC1_RGB8_OES
+    textureLoader.setCompressedFormats(formats);
+
+    //meshes sharing a texture share the upload
+    for (const Scene::Batch &batch : scene.getBatches()) {
+        if (!textures.contains(batch.texture)) {
+            textures.insert(batch.texture, nullptr);
+            textureLoader.load(batch.texture);
+        }
+    }
+    texturesPending = !textures.isEmpty();
+
+    QImage gray(1, 1, QImage::Format_RGBA8888);
+    gray.fill(QColor(128, 128, 128));
+    placeholderTexture = new QOpenGLTexture(gray, QOpenGLTexture::DontGenerateMipMaps);
+    batchTextures.assign(scene.getBatches().size(), placeholderTexture);
+}
+
+/**
+ * @brief PerspectiveRenderer::adoptTextures : upload the textures the loader has prepared since the last frame
+ */
+void PerspectiveRenderer::adoptTextures()
+{
+    TextureData data;
+    texturesPending = false;
+    for (auto it = textures.begin(); it != textures.end(); ++it) {
+        if (!it.value() && textureLoader.take(it.key(), data))
+            it.value() = uploadTexture(data);
+        texturesPending |= !it.value();
+    }
+
+    const std::vector<Scene::Batch> &batches = scene.getBatches();
+    for (size_t i = 0; i < batches.size(); i++) {
+        QOpenGLTexture *texture = textures.value(batches[i].texture);
+        batchTextures[i] = texture ? texture : placeholderTexture;
+    }
+}
+
+/**
+ * @brief PerspectiveRenderer::uploadTexture : create a texture with its prepared mip chain, no mipmap generation on the GPU
+ * @param data
+ * @return the texture, trilinear filtered
+ */
+QOpenGLTexture *PerspectiveRenderer::uploadTexture(const TextureData &data)
+{
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    QOpenGLTexture *texture = new QOpenGLTexture(QOpenGLTexture::Target2D);
+    if (data.isCompressed())
+        texture->setFormat(QOpenGLTexture::TextureFormat(data.glInternalFormat));
+    else // OpenGL ES 2 only takes unsized formats
+        texture->setFormat(context->isOpenGLES() && context->format().majorVersion() < 3
+                           ? QOpenGLTexture::RGBAFormat : QOpenGLTexture::RGBA8_UNorm);
+    texture->setSize(data.size.width(), data.size.height());
+    texture->setMipLevels(data.levels.size());
+    texture->allocateStorage();
+
+    for (int level = 0; level < data.levels.size(); level++) {
+        const QByteArray &bytes = data.levels[level];
+        if (data.isCompressed())
+            texture->setCompressedData(level, bytes.size(), bytes.constData());
+        else
+            texture->setData(level, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, bytes.constData());
+        countUpload(bytes.size());
+    }
+
+    texture->setMinificationFilter(data.levels.size() > 1 ? QOpenGLTexture::LinearMipMapLinear : QOpenGLTexture::Linear);
+    texture->setMagnificationFilter(QOpenGLTexture::Linear);
+    texture->setWrapMode(QOpenGLTexture::Repeat);
+    countState(3);
+    return texture;
+}
+
+/**
+ * @brief PerspectiveRenderer::isInstanced
+ * @return true if the objects of a mesh are drawn by one instanced draw, known after initialize()
+ */
+bool PerspectiveRenderer::isInstanced() const
+{
+    return instanced;
+}
+
+/**
+ * @brief PerspectiveRenderer::getShaderReport
+ * @return how the per object shaders were built by the last initialize()
+ */
+const ShaderCache::Report &PerspectiveRenderer::getShaderReport() const
+{
+    return shaderReport;
+}
+
+/**
+ * @brief PerspectiveRenderer::getTextureLoader
+ * @return the loader, its textureReady() signal says when a redraw would show a new texture
+ */
+TextureLoader &PerspectiveRenderer::getTextureLoader()
+{
+    return textureLoader;
+}
+
+/**
+ * @brief PerspectiveRenderer::texturesLoaded
+ * @return true once every texture has been uploaded
+ */
+bool PerspectiveRenderer::texturesLoaded() const
+{
+    return initialized && !texturesPending;
+}
+
+/**
+ * @brief PerspectiveRenderer::waitForTextures : block until the textures are decoded and upload them,
+ * the context must be current
+ */
+void PerspectiveRenderer::waitForTextures()
+{
+    textureLoader.waitForDone();
+    adoptTextures();
+}
+
+void PerspectiveRenderer::resize(int w, int h)
+{
+    targetWidth = qMax(1, w);
+    targetHeight = qMax(1, h);
+
+    // Recalculate aspect ratio
+    aspect = qreal(w) / qreal(h ? h : 1);
+
+    sceneWidth = 3.0;
+    sceneHeight = sceneWidth / aspect;
+
+    // The screen only changes here, its basis is cached for every frame until the next resize
+    float z = 0.0f;
+    const QVector3D pa = QVector3D(-sceneWidth, -sceneHeight, z);
+    const QVector3D pb = QVector3D(sceneWidth, -sceneHeight, z);
+    const QVector3D pc = QVector3D(-sceneWidth, sceneHeight, z);
+    projection.setScreen(pa, pb, pc);
+
+    // The box around the scene follows the screen
+    scene.setScreenSize(sceneWidth, sceneHeight);
+}
+
+/**
+ * @brief PerspectiveRenderer::render : draw one frame as seen from an eye position in front of the screen
+ * @param eye : eye position, the screen is the z = 0 plane
+ * @param zFar : far plane distance
+ */
+void PerspectiveRenderer::render(const QVector3D &eye, float zFar)
+{
+    beginFrame();
+
+    eyeFrustums[0] = projection.matrix(eye, zNear, zFar); //magic
+
+    useProgram(instanced ? instancedProgram : program);
+    drawScene(1);
+}
+
+/**
+ * @brief PerspectiveRenderer::renderStereo : draw one frame for each eye, the left eye into the left half of the
+ * target and the right eye into the right half. Each view keeps the whole screen squeezed to half the width,
+ * the layout side by side displays stretch back. The scene is culled once, with as many draws as in mono where
+ * the context has instancing and clip distances, one instanced pass per eye where it only has instancing.
+ * @param leftEye : eye position drawn into the left half
+ * @param rightEye : eye position drawn into the right half
+ * @param zFar : far plane distance
+ */
+void PerspectiveRenderer::renderStereo(const QVector3D &leftEye, const QVector3D &rightEye, float zFar)
+{
+    beginFrame();
+
+    eyeFrustums[0] = projection.matrix(leftEye, zNear, zFar);
+    eyeFrustums[1] = projection.matrix(rightEye, zNear, zFar);
+
+    useProgram(initializeStereo() ? stereoProgram : instanced ? instancedProgram : program);
+    drawScene(2);
+}
+
+/**
+ * @brief PerspectiveRenderer::beginFrame : upload the textures that arrived and clear the target
+ */
+void PerspectiveRenderer::beginFrame()
+{
+    counters.frames++;
+
+    if (texturesPending)
+        adoptTextures();
+
+    // Clear color and depth buffer
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    countCalls(1);
+}
+
+/**
+ * @brief PerspectiveRenderer::drawScene : cull the objects against the eye frustums of the frame and draw the visible ones
+ * @param views : 1 for mono, 2 for side by side stereo
+ */
+void PerspectiveRenderer::drawScene(int views)
+{
+    qint64 start = monotonicNs();
+    const int visible = scene.cull(eyeFrustums, views);
+    counters.cullNs += monotonicNs() - start;
+    counters.objects += scene.objectCount();
+    counters.visibleObjects += visible;
+
+    bindGeometry();
+
+    // Instanced stereo draws both eyes at once where the eyes are clipped in the vertex stage,
+    // otherwise one pass per eye into its own viewport
+    const bool bothEyes = views == 1 || stereoInstanced;
+    const int passes = instanced && !bothEyes ? views : 1;
+    if (instanced) {
+        uploadInstances(visible);
+
+        if (views > 1 && stereoInstanced) {
+            glEnable(GL_CLIP_DISTANCE0);
+            glEnable(GL_CLIP_DISTANCE0 + 1);
+            countState(2);
+        }
+    }
+
+    for (int pass = 0; pass < passes; pass++) {
+        const int eyes = bothEyes ? views : 1;
+        if (instanced) {
+            // The view-projections are the same for every mesh, one upload per pass
+            QOpenGLShaderProgram &current = eyes == 1 ? instancedProgram : stereoProgram;
+            current.setUniformValueArray(eyes == 1 ? viewProjectionLocation : stereoViewProjectionLocation,
+                                         eyeFrustums + pass, eyes);
+            countUniform();
+
+            // Stereo draws each object twice in a row, the model matrix moves on every second instance
+            if (instanceDivisor != eyes) {
+                instanceDivisor = eyes;
+                for (int row = 0; row < 3; row++)
+                    extraFunctions->glVertexAttribDivisor(GLuint(modelLocation + row), GLuint(eyes));
+                countState(3);
+            }
+
+            if (passes > 1) {
+                glViewport(pass * targetWidth / 2, 0, targetWidth / 2, targetHeight);
+                countState();
+            }
+        }
+
+        GLenum cullFace = 0;
+        const std::vector<Scene::Batch> &batches = scene.getBatches();
+        for (size_t i = 0; i < batches.size(); i++) {
+            if (!batches[i].visibleCount)
+                continue;
+
+            const GLenum face = batches[i].insideOut ? GL_FRONT : GL_BACK;
+            if (face != cullFace) {
+                glCullFace(face);
+                countState();
+                cullFace = face;
+            }
+            batchTextures[i]->bind();
+            countState();
+
+            if (instanced)
+                drawInstanced(int(i), eyes);
+            else
+                drawEach(int(i), views);
+        }
+    }
+
+    if (views > 1 && stereoInstanced) {
+        glDisable(GL_CLIP_DISTANCE0);
+        glDisable(GL_CLIP_DISTANCE0 + 1);
+        countState(2);
+    } else if (views > 1) {
+        glViewport(0, 0, targetWidth, targetHeight);
+        countState();
+    }
+}
+
+/**
+ * @brief PerspectiveRenderer::uploadInstances : write the model matrix rows of the visible objects into the instance
+ * buffer, each batch a range of each row stream
+ * @param visible : visible objects in all batches
+ */
+void PerspectiveRenderer::uploadInstances(int visible)
+{
+    const std::vector<Scene::Batch> &batches = scene.getBatches();
+    if (int(instanceRows.size()) < 3 * visible)
+        instanceRows.resize(3 * visible);
+
+    QVector4D *rows[3] = {instanceRows.data(), instanceRows.data() + visible, instanceRows.data() + 2 * visible};
+    instanceStream = visible;
+    int next = 0;
+    for (size_t i = 0; i < batches.size(); i++) {
+        const Scene::Batch &batch = batches[i];
+        batchFirstInstance[i] = next;
+        for (int v = 0; v < batch.visibleCount; v++, next++) {
+            const int instance = batch.visible[v];
+            rows[0][next] = batch.rows[0][instance];
+            rows[1][next] = batch.rows[1][instance];
+            rows[2][next] = batch.rows[2][instance];
+        }
+    }
+
+    // Reallocating every frame lets the driver hand out new storage instead of waiting on the last frame's draws
+    instanceBuffer.bind();
+    instanceBuffer.allocate(instanceRows.data(), 3 * visible * int(sizeof(QVector4D)));
+    countState();
+    countUpload(3 * visible * int(sizeof(QVector4D)));
+}
+
+/**
+ * @brief PerspectiveRenderer::drawInstanced : draw the visible objects of a batch in one draw,
+ * uploadInstances() must have been called for the frame
+ * @param batch
+ * @param views : 1 for mono, 2 for side by side stereo
+ */
+void PerspectiveRenderer::drawInstanced(int batch, int views)
+{
+    const Mesh &mesh = meshes[batch];
+    const int count = scene.getBatches()[batch].visibleCount;
+
+    // The instance buffer is still bound from uploadInstances(), the attributes point into it
+    for (int row = 0; row < 3; row++) {
+        const size_t first = size_t(row * instanceStream + batchFirstInstance[batch]) * sizeof(QVector4D);
+        extraFunctions->glVertexAttribPointer(GLuint(modelLocation + row), 4, GL_FLOAT, GL_FALSE, 0,
+                                              reinterpret_cast<const void *>(first));
+    }
+    countState(3);
+
+    extraFunctions->glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_SHORT,
+                                            reinterpret_cast<const void *>(mesh.firstIndex * sizeof(GLushort)), count * views);
+    countDraw();
+}
+
+/**
+ * @brief PerspectiveRenderer::drawEach : draw the visible objects of a batch one by one, for each eye into
+ * its half of the target in stereo
+ * @param batch
+ * @param views : 1 for mono, 2 for side by side stereo
+ */
+void PerspectiveRenderer::drawEach(int batch, int views)
+{
+    const Mesh &mesh = meshes[batch];
+    const Scene::Batch &objects = scene.getBatches()[batch];
+    const void *offset = reinterpret_cast<const void *>(mesh.firstIndex * sizeof(GLushort));
+
+    for (int view = 0; view < views; view++) {
+        if (views > 1) {
+            glViewport(view * targetWidth / 2, 0, targetWidth / 2, targetHeight);
+            countState();
+        }
+        for (int v = 0; v < objects.visibleCount; v++) {
+            const int instance = objects.visible[v];
+            const QVector4D &r0 = objects.rows[0][instance], &r1 = objects.rows[1][instance], &r2 = objects.rows[2][instance];
+            const QMatrix4x4 model(r0.x(), r0.y(), r0.z(), r0.w(),
+                                   r1.x(), r1.y(), r1.z(), r1.w(),
+                                   r2.x(), r2.y(), r2.z(), r2.w(),
+                                   0.0f, 0.0f, 0.0f, 1.0f);
+
+            // Model-view-projection premultiplied here, one uniform per draw
+            program.setUniformValue(mvpLocation, eyeFrustums[view] * model);
+            countUniform();
+            glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_SHORT, offset);
+            countDraw();
+        }
+    }
+}
+
+/**
+ * @brief PerspectiveRenderer::getCounters
+ * @return GL work issued since the last resetCounters()
+ */
+const RenderCounters &PerspectiveRenderer::getCounters() const
+{
+    return counters;
+}
+
+/**
+ * @brief PerspectiveRenderer::resetCounters
+ */
+void PerspectiveRenderer::resetCounters()
+{
+    counters = RenderCounters();
+}
+
+/**
+ * @brief PerspectiveRenderer::uploadGeometry : put the vertices and indices of every mesh of the scene in one static
+ * vertex buffer and one static index buffer, and record the attribute layout in a vertex array object
+ * @return false if the meshes have more vertices together than 16 bit indices reach
+ */
+bool PerspectiveRenderer::uploadGeometry()
+{
+    const std::vector<Scene::Batch> &batches = scene.getBatches();
+    QVector<MeshVertex> vertices;
+    QVector<GLushort> indices;
+    meshes.clear();
+    for (const Scene::Batch &batch : batches) {
+        // GLES 2 has no base vertex draws, the indices of each mesh are moved past the vertices before it
+        const int base = vertices.size();
+        if (base + batch.mesh.vertices.size() > 65536) {
+            qDebug() << "The scene meshes have more than 65536 vertices together";
+            return false;
+        }
+        meshes.push_back({indices.size(), batch.mesh.indices.size()});
+        vertices += batch.mesh.vertices;
+        for (quint16 index : batch.mesh.indices)
+            indices.append(GLushort(index + base));
+    }
+    batchFirstInstance.assign(batches.size(), 0);
+
+    vertexArena.create();
+    vertexArena.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    vertexArena.bind();
+    vertexArena.allocate(vertices.constData(), vertices.size() * int(sizeof(MeshVertex)));
+
+    // The VAO captures the index buffer binding and the attribute layout, so a frame only binds it
+    if (vao.create())
+        vao.bind();
+    else
+        instanced = false; // the instance attributes would have to be set up again for every draw
+
+    indexArena.create();
+    indexArena.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    indexArena.bind();
+    indexArena.allocate(indices.constData(), indices.size() * int(sizeof(GLushort)));
+
+    initAttributes();
+
+    if (instanced) {
+        instanceBuffer.create();
+        instanceBuffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+        for (int row = 0; row < 3; row++)
+            extraFunctions->glEnableVertexAttribArray(GLuint(modelLocation + row));
+    }
+
+    if (vao.isCreated())
+        vao.release();
+    return true;
+}
+
+/**
+ * @brief PerspectiveRenderer::bindGeometry : make the geometry arena current for the draws of a frame
+ */
+void PerspectiveRenderer::bindGeometry()
+{
+    if (vao.isCreated()) {
+        vao.bind();
+        countState();
+        return;
+    }
+
+    // No vertex array objects on this GLES 2 device: set the layout up again from the fixed locations
+    vertexArena.bind();
+    indexArena.bind();
+    countState(2);
+    initAttributes();
+}
+
+void PerspectiveRenderer::initAttributes()
+{
+    // Offset for position
+    size_t offset = 0;
+
+    // Tell OpenGL programmable pipeline how to locate vertex position data
+    glEnableVertexAttribArray(GLuint(vertexLocation));
+    glVertexAttribPointer(GLuint(vertexLocation), 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), reinterpret_cast<const void *>(offset));
+
+    // Offset for texture coordinate
+    offset += sizeof(QVector3D);
+
+    // Tell OpenGL programmable pipeline how to locate vertex texture coordinate data
+    glEnableVertexAttribArray(GLuint(texcoordLocation));
+    glVertexAttribPointer(GLuint(texcoordLocation), 2, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), reinterpret_cast<const void *>(offset));
+
+    countState(4);
+}
@@ -0,0 +1,148 @@
+#ifndef PERSPECTIVERENDERER_H
+#define PERSPECTIVERENDERER_H
+
+#include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
+#include <QMatrix4x4>
+#include <QHash>
+#include <QVector3D>
+#include <QVector4D>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include "offaxisprojection.h"
+#include "scene.h"
+#include "shadercache.h"
+#include "textureloader.h"
+
+/**
+ * @brief The RenderCounters struct : what the renderer asked of OpenGL, every Qt wrapper call counted as the GL call it makes
+ */
+struct RenderCounters
+{
+    quint64 frames = 0;
+    quint64 glCalls = 0;
+    quint64 drawCalls = 0;
+    quint64 stateChanges = 0;   // binds, enables, attribute setup, cull face
+    quint64 uniformUploads = 0;
+    quint64 bufferUploads = 0;
+    quint64 uploadedBytes = 0;
+    quint64 objects = 0;        // in the scene, summed over the frames
+    quint64 visibleObjects = 0; // kept by the frustum culling
+    qint64 cullNs = 0;
+};
+
+/**
+ * @brief The PerspectiveRenderer class : draws the scene through the off-axis projection of an eye position into
+ * whatever surface is current, an on-screen window or an offscreen framebuffer. In stereo each eye gets its own
+ * projection and half of the target, side by side. Every frame the objects are culled against the frustum and the
+ * visible ones of each mesh are drawn by one instanced draw, one draw per object where the context has no instancing.
+ */
+class PerspectiveRenderer : protected QOpenGLFunctions
+{
+public:
+    PerspectiveRenderer();
+    ~PerspectiveRenderer();
+
+    bool loadScene(const QString &path);
+    Scene &getScene();
+    void setInstancing(bool enabled);
+
+    bool initialize();
+    void destroy();
+    void resize(int w, int h);
+    void render(const QVector3D &eye, float zFar);
+    bool initializeStereo();
+    void renderStereo(const QVector3D &leftEye, const QVector3D &rightEye, float zFar);
+
+    const RenderCounters &getCounters() const;
+    void resetCounters();
+
+    bool isInstanced() const;
+    const ShaderCache::Report &getShaderReport() const;
+    TextureLoader &getTextureLoader();
+    bool texturesLoaded() const;
+    void waitForTextures();
+
+private:
+    bool initShaders();
+    bool initInstancedShaders(QOpenGLShaderProgram &target, const QString &name, const QByteArray &defines);
+    void useProgram(QOpenGLShaderProgram &next);
+    void loadTextures();
+    void adoptTextures();
+    QOpenGLTexture *uploadTexture(const TextureData &data);
+    struct Mesh
+    {
+        int firstIndex;
+        int indexCount;
+    };
+
+    bool uploadGeometry();
+    void bindGeometry();
+    void initAttributes();
+    void beginFrame();
+    void drawScene(int views);
+    void uploadInstances(int visible);
+    void drawInstanced(int batch, int views);
+    void drawEach(int batch, int views);
+
+    void countCalls(int calls) { counters.glCalls += calls; }
+    void countState(int changes = 1) { counters.stateChanges += changes; countCalls(changes); }
+    void countUniform() { counters.uniformUploads++; countCalls(1); }
+    void countUpload(int bytes) { counters.bufferUploads++; counters.uploadedBytes += bytes; countCalls(1); }
+    void countDraw() { counters.drawCalls++; countCalls(1); }
+
+private:
+    bool initialized = false;
+    RenderCounters counters;
+
+    Scene scene;
+
+    // One draw per object, for contexts without instancing
+    QOpenGLShaderProgram program;
+    ShaderCache::Report shaderReport;
+    int mvpLocation = -1;
+
+    // One draw per mesh, the stereo one draws both eyes
+    QOpenGLShaderProgram instancedProgram;
+    QOpenGLShaderProgram stereoProgram;
+    QOpenGLExtraFunctions *extraFunctions = nullptr;
+    bool instancing = true, instanced = false;
+    bool stereoInitialized = false, stereoInstanced = false;
+    int viewProjectionLocation = -1, stereoViewProjectionLocation = -1;
+    QOpenGLShaderProgram *activeProgram = nullptr;
+
+    // Decoded in the background, meshes are drawn with the placeholder until their texture is uploaded
+    TextureLoader textureLoader;
+    QHash<QString, QOpenGLTexture *> textures;
+    std::vector<QOpenGLTexture *> batchTextures;
+    QOpenGLTexture *placeholderTexture = nullptr;
+    bool texturesPending = false;
+
+    // All meshes share one static vertex buffer and one index buffer, uploaded once
+    QOpenGLBuffer vertexArena;
+    QOpenGLBuffer indexArena;
+    QOpenGLVertexArrayObject vao;
+    std::vector<Mesh> meshes;
+    int vertexLocation = 0, texcoordLocation = 1, modelLocation = 2;
+
+    // Model matrix rows of the visible objects, all first rows, then all second rows, then all third rows,
+    // refilled every frame. Each batch is a range in each of them.
+    QOpenGLBuffer instanceBuffer;
+    std::vector<QVector4D> instanceRows;
+    std::vector<int> batchFirstInstance;
+    int instanceStream = 0;     // length of each row stream this frame
+    int instanceDivisor = 0;
+
+    OffAxisProjection projection;
+    QMatrix4x4 eyeFrustums[2];
+
+    float zNear = 0.1f;
+    float aspect = 1.0f;
+    int targetWidth = 1, targetHeight = 1;
+
+    float sceneWidth = 3.0f, sceneHeight = 3.0f;
+};
+
+#endif // PERSPECTIVERENDERER_H
@@ -0,0 +1,161 @@
+#include "posefilter.h"
+#include <QtMath>
+
+/**
+ * @brief PoseFilter::predictionSeconds
+ * @param timeNs : time to predict for
+ * @return seconds from the last measurement to timeNs, clamped to the max prediction
+ */
+float PoseFilter::predictionSeconds(qint64 timeNs) const {
+    return qBound<qint64>(0, timeNs - lastTimestampNs, maxPredictionNs) / 1e9f;
+}
+
+/**
+ * @brief PoseFilter::updateSeconds : advance the filter clock to a new measurement
+ * @param timestampNs
+ * @return seconds since the previous measurement, 0 for the first one or an out of order one
+ */
+float PoseFilter::updateSeconds(qint64 timestampNs) {
+    float dt = lastTimestampNs != 0 && timestampNs > lastTimestampNs ? (timestampNs - lastTimestampNs) / 1e9f : 0.0f;
+    lastTimestampNs = qMax(lastTimestampNs, timestampNs);
+    return dt;
+}
+
+/**
+ * @brief OneEuroPoseFilter::OneEuroPoseFilter : constructor
+ * @param minCutoff : cutoff frequency in Hz when still, lower is smoother
+ * @param beta : how fast the cutoff rises with speed, higher is less lag
+ * @param derivativeCutoff : cutoff frequency of the velocity estimate in Hz
+ */
+OneEuroPoseFilter::OneEuroPoseFilter(float minCutoff, float beta, float derivativeCutoff) :
+    minCutoff(minCutoff),
+    beta(beta),
+    derivativeCutoff(derivativeCutoff)
+{
+}
+
+/**
+ * @brief OneEuroPoseFilter::reset : forget the history, the next measurement is taken as is
+ */
+void OneEuroPoseFilter::reset() {
+    lastTimestampNs = 0;
+    value = QVector3D();
+    velocity = QVector3D();
+}
+
+/**
+ * @brief OneEuroPoseFilter::update : filter a new measurement
+ * @param position : measured camera position
+ * @param timestampNs : capture time of the frame it was measured in
+ */
+void OneEuroPoseFilter::update(const QVector3D &position, qint64 timestampNs) {
+    bool first = !hasSamples();
+    float dt = updateSeconds(timestampNs);
+    if (first) {
+        value = position;
+        velocity = QVector3D();
+        return;
+    }
+    if (dt <= 0.0f)
+        return;
+
+    auto alpha = [dt](float cutoff) {
+        float tau = 1.0f / (2.0f * float(M_PI) * cutoff);
+        return 1.0f / (1.0f + tau / dt);
+    };
+
+    QVector3D rawVelocity = (position - value) / dt;
+    velocity += alpha(derivativeCutoff) * (rawVelocity - velocity);
+
+    for (int i = 0; i < 3; i++) {
+        float cutoff = minCutoff + beta * qAbs(velocity[i]);
+        value[i] += alpha(cutoff) * (position[i] - value[i]);
+    }
+}
+
+/**
+ * @brief OneEuroPoseFilter::predict
+ * @param timeNs : time the frame will be displayed
+ * @return the filtered position moved forward by the filtered velocity
+ */
+QVector3D OneEuroPoseFilter::predict(qint64 timeNs) const {
+    return value + velocity * predictionSeconds(timeNs);
+}
+
+/**
+ * @brief KalmanPoseFilter::KalmanPoseFilter : constructor
+ * @param processNoise : variance of the acceleration of the head, higher follows faster moves
+ * @param measurementNoise : variance of the detector measurements, higher is smoother
+ */
+KalmanPoseFilter::KalmanPoseFilter(float processNoise, float measurementNoise) :
+    processNoise(processNoise),
+    measurementNoise(measurementNoise)
+{
+}
+
+/**
+ * @brief KalmanPoseFilter::reset : forget the history, the next measurement is taken as is
+ */
+void KalmanPoseFilter::reset() {
+    lastTimestampNs = 0;
+    for (Axis &axis : axes)
+        axis = Axis();
+}
+
+/**
+ * @brief KalmanPoseFilter::update : predict the state to the measurement time and correct it
+ * @param position : measured camera position
+ * @param timestampNs : capture time of the frame it was measured in
+ */
+void KalmanPoseFilter::update(const QVector3D &position, qint64 timestampNs) {
+    bool first = !hasSamples();
+    float dt = updateSeconds(timestampNs);
+    for (int i = 0; i < 3; i++) {
+        if (first) {
+            axes[i] = Axis();
+            axes[i].x = position[i];
+            axes[i].p00 = measurementNoise;
+        } else {
+            updateAxis(axes[i], position[i], dt);
+        }
+    }
+}
+
+/**
+ * @brief KalmanPoseFilter::updateAxis : one predict/correct step of a position/velocity state
+ * @param axis
+ * @param measurement
+ * @param dt : seconds since the previous measurement
+ */
+void KalmanPoseFilter::updateAxis(Axis &axis, float measurement, float dt) {
+    //predict: x' = F x, P' = F P F^T + Q with F = [1 dt; 0 1]
+    axis.x += axis.v * dt;
+    float dt2 = dt * dt, dt3 = dt2 * dt, dt4 = dt3 * dt;
+    float p00 = axis.p00 + dt * (axis.p10 + axis.p01) + dt2 * axis.p11 + processNoise * dt4 / 4.0f;
+    float p01 = axis.p01 + dt * axis.p11 + processNoise * dt3 / 2.0f;
+    float p10 = axis.p10 + dt * axis.p11 + processNoise * dt3 / 2.0f;
+    float p11 = axis.p11 + processNoise * dt2;
+
+    //correct with the measured position, H = [1 0]
+    float innovation = measurement - axis.x;
+    float s = p00 + measurementNoise;
+    float k0 = p00 / s, k1 = p10 / s;
+    axis.x += k0 * innovation;
+    axis.v += k1 * innovation;
+    axis.p00 = (1.0f - k0) * p00;
+    axis.p01 = (1.0f - k0) * p01;
+    axis.p10 = p10 - k1 * p00;
+    axis.p11 = p11 - k1 * p01;
+}
+
+/**
+ * @brief KalmanPoseFilter::predict
+ * @param timeNs : time the frame will be displayed
+ * @return the estimated position moved forward by the estimated velocity
+ */
+QVector3D KalmanPoseFilter::predict(qint64 timeNs) const {
+    float dt = predictionSeconds(timeNs);
+    return QVector3D(axes[0].x + axes[0].v * dt,
+                     axes[1].x + axes[1].v * dt,
+                     axes[2].x + axes[2].v * dt);
+}
@@ -0,0 +1,77 @@
+#ifndef POSEFILTER_H
+#define POSEFILTER_H
+
+#include <QVector3D>
+
+/**
+ * @brief The PoseFilter class : smooths the timestamped camera positions measured by the detector and
+ * extrapolates them to the time a frame will be displayed, so the renderer can run faster than detection.
+ */
+class PoseFilter
+{
+public:
+    virtual ~PoseFilter() {}
+
+    virtual void reset() = 0;
+    virtual void update(const QVector3D &position, qint64 timestampNs) = 0;
+    virtual QVector3D predict(qint64 timeNs) const = 0;
+
+    bool hasSamples() const { return lastTimestampNs != 0; }
+
+    //predictions never go further than this past the last measurement
+    void setMaxPredictionNs(qint64 ns) { maxPredictionNs = ns; }
+
+protected:
+    float predictionSeconds(qint64 timeNs) const;
+    float updateSeconds(qint64 timestampNs);
+
+protected:
+    qint64 lastTimestampNs = 0;
+    qint64 maxPredictionNs = 100000000;
+};
+
+/**
+ * @brief The OneEuroPoseFilter class : One Euro filter, the cutoff rises with speed so slow moves are smooth
+ * and fast moves have little lag. Predicts with the filtered velocity.
+ */
+class OneEuroPoseFilter : public PoseFilter
+{
+public:
+    explicit OneEuroPoseFilter(float minCutoff = 1.0f, float beta = 0.5f, float derivativeCutoff = 1.0f);
+
+    void reset() override;
+    void update(const QVector3D &position, qint64 timestampNs) override;
+    QVector3D predict(qint64 timeNs) const override;
+
+private:
+    float minCutoff, beta, derivativeCutoff;
+    QVector3D value;
+    QVector3D velocity;
+};
+
+/**
+ * @brief The KalmanPoseFilter class : constant velocity Kalman filter, one position/velocity state per axis
+ */
+class KalmanPoseFilter : public PoseFilter
+{
+public:
+    explicit KalmanPoseFilter(float processNoise = 50.0f, float measurementNoise = 0.05f);
+
+    void reset() override;
+    void update(const QVector3D &position, qint64 timestampNs) override;
+    QVector3D predict(qint64 timeNs) const override;
+
+private:
+    struct Axis
+    {
+        float x = 0.0f, v = 0.0f;
+        float p00 = 1.0f, p01 = 0.0f, p10 = 0.0f, p11 = 1.0f;
+    };
+    void updateAxis(Axis &axis, float measurement, float dt);
+
+private:
+    float processNoise, measurementNoise;
+    Axis axes[3];
+};
+
+#endif // POSEFILTER_H
@@ -0,0 +1,130 @@
+#include "pupilkernels.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PUPIL_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define PUPIL_NEON // 32 bit NEON has no vector division or square root, it takes the scalar path
+#include <arm_neon.h>
+#endif
+
+// keeps the candidate on the gradient point itself at 0 instead of 0 / 0
+static const float minSquaredDistance = 1e-6f;
+
+/**
+ * @brief scalarRow : contribution of the gradient point (px, py) to the candidates [fromX, width) of row cy
+ */
+static inline void scalarRow(float px, float py, float gx, float gy, int cy, float *row, int fromX, int width) {
+    const float dy = py - float(cy);
+    const float dySquared = dy * dy;
+    const float dyGy = dy * gy;
+    for (int cx = fromX; cx < width; cx++) {
+        const float dx = px - float(cx);
+        const float length = std::sqrt(std::max(dx * dx + dySquared, minSquaredDistance));
+        const float dot = std::max((dx * gx + dyGy) / length, 0.0f);
+        row[cx] += dot * dot;
+    }
+}
+
+void PupilKernels::accumulateCentersScalar(const float *gx, const float *gy, int gradientStride, int width, int height,
+                                           float *objective, int objectiveStride) {
+    for (int py = 0; py < height; py++) {
+        for (int px = 0; px < width; px++) {
+            const float x = gx[py * gradientStride + px], y = gy[py * gradientStride + px];
+            if (x == 0.0f && y == 0.0f)
+                continue;
+            for (int cy = 0; cy < height; cy++)
+                scalarRow(float(px), float(py), x, y, cy, objective + cy * objectiveStride, 0, width);
+        }
+    }
+}
+
+#if defined(PUPIL_SSE2)
+
+const char *PupilKernels::instructionSet() {
+    return "SSE2";
+}
+
+void PupilKernels::accumulateCenters(const float *gx, const float *gy, int gradientStride, int width, int height,
+                                     float *objective, int objectiveStride) {
+    const int vectorWidth = width & ~3;
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128 zero = _mm_setzero_ps(), minimum = _mm_set1_ps(minSquaredDistance);
+
+    for (int py = 0; py < height; py++) {
+        for (int px = 0; px < width; px++) {
+            const float x = gx[py * gradientStride + px], y = gy[py * gradientStride + px];
+            if (x == 0.0f && y == 0.0f)
+                continue;
+            const __m128 pxv = _mm_set1_ps(float(px)), gxv = _mm_set1_ps(x);
+
+            for (int cy = 0; cy < height; cy++) {
+                float *row = objective + cy * objectiveStride;
+                const float dy = float(py) - float(cy);
+                const __m128 dySquared = _mm_set1_ps(dy * dy), dyGy = _mm_set1_ps(dy * y);
+
+                for (int cx = 0; cx < vectorWidth; cx += 4) {
+                    __m128 dx = _mm_sub_ps(pxv, _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(cx), lanes)));
+                    __m128 length = _mm_sqrt_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(dx, dx), dySquared), minimum));
+                    __m128 dot = _mm_max_ps(_mm_div_ps(_mm_add_ps(_mm_mul_ps(dx, gxv), dyGy), length), zero);
+                    _mm_storeu_ps(row + cx, _mm_add_ps(_mm_loadu_ps(row + cx), _mm_mul_ps(dot, dot)));
+                }
+                if (vectorWidth < width)
+                    scalarRow(float(px), float(py), x, y, cy, row, vectorWidth, width);
+            }
+        }
+    }
+}
+
+#elif defined(PUPIL_NEON)
+
+const char *PupilKernels::instructionSet() {
+    return "NEON";
+}
+
+void PupilKernels::accumulateCenters(const float *gx, const float *gy, int gradientStride, int width, int height,
+                                     float *objective, int objectiveStride) {
+    const int vectorWidth = width & ~3;
+    static const int32_t laneOffsets[4] = {0, 1, 2, 3};
+    const int32x4_t lanes = vld1q_s32(laneOffsets);
+    const float32x4_t zero = vdupq_n_f32(0.0f), minimum = vdupq_n_f32(minSquaredDistance);
+
+    for (int py = 0; py < height; py++) {
+        for (int px = 0; px < width; px++) {
+            const float x = gx[py * gradientStride + px], y = gy[py * gradientStride + px];
+            if (x == 0.0f && y == 0.0f)
+                continue;
+            const float32x4_t pxv = vdupq_n_f32(float(px)), gxv = vdupq_n_f32(x);
+
+            for (int cy = 0; cy < height; cy++) {
+                float *row = objective + cy * objectiveStride;
+                const float dy = float(py) - float(cy);
+                const float32x4_t dySquared = vdupq_n_f32(dy * dy), dyGy = vdupq_n_f32(dy * y);
+
+                for (int cx = 0; cx < vectorWidth; cx += 4) {
+                    float32x4_t dx = vsubq_f32(pxv, vcvtq_f32_s32(vaddq_s32(vdupq_n_s32(cx), lanes)));
+                    float32x4_t length = vsqrtq_f32(vmaxq_f32(vaddq_f32(vmulq_f32(dx, dx), dySquared), minimum));
+                    float32x4_t dot = vmaxq_f32(vdivq_f32(vaddq_f32(vmulq_f32(dx, gxv), dyGy), length), zero);
+                    vst1q_f32(row + cx, vaddq_f32(vld1q_f32(row + cx), vmulq_f32(dot, dot)));
+                }
+                if (vectorWidth < width)
+                    scalarRow(float(px), float(py), x, y, cy, row, vectorWidth, width);
+            }
+        }
+    }
+}
+
+#else
+
+const char *PupilKernels::instructionSet() {
+    return "scalar";
+}
+
+void PupilKernels::accumulateCenters(const float *gx, const float *gy, int gradientStride, int width, int height,
+                                     float *objective, int objectiveStride) {
+    accumulateCentersScalar(gx, gy, gradientStride, width, height, objective, objectiveStride);
+}
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef PUPILKERNELS_H
+#define PUPILKERNELS_H
+
+/**
+ * Eye center objective of Timm & Barth: the center of a dark round pupil is the point the image gradients around it
+ * point away from. For every candidate center c and every gradient point p, adds max(0, dot(normalize(p - c), g(p)))^2.
+ * Vectorized over the candidates of a row, SSE2 on x86, NEON on 64 bit ARM, scalar everywhere else.
+ */
+namespace PupilKernels {
+
+// gx, gy: unit gradients of a width x height image, zero where the gradient is too weak to count;
+// objective: width x height sums, added to. Strides are in floats.
+void accumulateCenters(const float *gx, const float *gy, int gradientStride, int width, int height,
+                       float *objective, int objectiveStride);
+
+// reference implementation, the vector paths give the same sums up to float rounding
+void accumulateCentersScalar(const float *gx, const float *gy, int gradientStride, int width, int height,
+                             float *objective, int objectiveStride);
+
+const char *instructionSet();
+
+}
+
+#endif // PUPILKERNELS_H
@@ -0,0 +1,124 @@
+#include "pupillocator.h"
+#include "pupilkernels.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+
+// eye regions as fractions of the face box, the usual proportions of a frontal face
+static const float eyeTop = 0.25f;
+static const float eyeSide = 0.13f;
+static const float eyeWidth = 0.35f;
+static const float eyeHeight = 0.30f;
+
+static const int fastWidth = 40;                // eye regions are scaled down to this width, the cost grows with its fourth power
+static const double gradientThreshold = 0.3;   // gradients weaker than mean + this many standard deviations are ignored
+
+/**
+ * @brief PupilLocator::eyeRegion : where an eye is expected inside a face
+ * @param face : face box in the image
+ * @param leftEye : the eye on the left of the image
+ * @return the region in image coordinates
+ */
+cv::Rect PupilLocator::eyeRegion(const cv::Rect &face, bool leftEye) {
+    const int width = cvRound(face.width * eyeWidth);
+    const int side = cvRound(face.width * eyeSide);
+    const int x = leftEye ? face.x + side : face.x + face.width - side - width;
+    return cv::Rect(x, face.y + cvRound(face.height * eyeTop), width, cvRound(face.height * eyeHeight));
+}
+
+/**
+ * @brief PupilLocator::locate : find both pupils of a face
+ * @param gray : 8 bit luminance image
+ * @param face : face found in the image
+ * @param leftPupil : receives the pupil on the left of the image, sub-pixel image coordinates
+ * @param rightPupil : receives the other one
+ * @return false if an eye region is outside the image or has no usable gradients
+ */
+bool PupilLocator::locate(const cv::Mat &gray, const cv::Rect &face, cv::Point2f &leftPupil, cv::Point2f &rightPupil) {
+    return locateInRegion(gray, eyeRegion(face, true), leftPupil) && locateInRegion(gray, eyeRegion(face, false), rightPupil);
+}
+
+/**
+ * @brief PupilLocator::locateInRegion : find the pupil inside one eye region
+ * @param gray : 8 bit luminance image
+ * @param region : eye region, see eyeRegion()
+ * @param pupil : receives the center, sub-pixel image coordinates
+ * @return false if the region is outside the image or has no usable gradients
+ */
+bool PupilLocator::locateInRegion(const cv::Mat &gray, const cv::Rect &region, cv::Point2f &pupil) {
+    if (region.width < 4 || region.height < 4 || (region & cv::Rect(0, 0, gray.cols, gray.rows)) != region)
+        return false;
+
+    //smaller regions are used as they are, bigger ones are area averaged down
+    const float scale = region.width > fastWidth ? float(fastWidth) / region.width : 1.0f;
+    if (scale < 1.0f)
+        cv::resize(gray(region), eye, cv::Size(fastWidth, std::max(4, cvRound(region.height * scale))), 0, 0, cv::INTER_AREA);
+    else
+        gray(region).copyTo(eye);
+
+    //unit gradients, only the strong ones vote
+    cv::Sobel(eye, gradientX, CV_32F, 1, 0, 3);
+    cv::Sobel(eye, gradientY, CV_32F, 0, 1, 3);
+    cv::magnitude(gradientX, gradientY, magnitude);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(magnitude, mean, stddev);
+    const float threshold = float(mean[0] + gradientThreshold * stddev[0]);
+    int votes = 0;
+    for (int y = 0; y < eye.rows; y++) {
+        float *gx = gradientX.ptr<float>(y), *gy = gradientY.ptr<float>(y);
+        const float *m = magnitude.ptr<float>(y);
+        for (int x = 0; x < eye.cols; x++) {
+            if (m[x] > threshold && m[x] > 0.0f) {
+                gx[x] /= m[x];
+                gy[x] /= m[x];
+                votes++;
+            } else {
+                gx[x] = gy[x] = 0.0f;
+            }
+        }
+    }
+    if (!votes)
+        return false;
+
+    objective.create(eye.size(), CV_32F);
+    objective.setTo(0.0f);
+    const int gradientStride = int(gradientX.step1());
+    if (useReference)
+        PupilKernels::accumulateCentersScalar(gradientX.ptr<float>(), gradientY.ptr<float>(), gradientStride,
+                                              eye.cols, eye.rows, objective.ptr<float>(), int(objective.step1()));
+    else
+        PupilKernels::accumulateCenters(gradientX.ptr<float>(), gradientY.ptr<float>(), gradientStride,
+                                        eye.cols, eye.rows, objective.ptr<float>(), int(objective.step1()));
+
+    //the pupil is dark: weigh every candidate by its inverted, smoothed intensity
+    cv::GaussianBlur(eye, smoothed, cv::Size(5, 5), 0);
+    smoothed.convertTo(weight, CV_32F, -1.0, 255.0);
+    cv::multiply(objective, weight, objective);
+
+    cv::Point best;
+    cv::minMaxLoc(objective, nullptr, nullptr, nullptr, &best);
+
+    //parabola through the peak and its neighbours for the sub-pixel offset
+    auto refine = [](float before, float peak, float after) {
+        float curvature = before - 2.0f * peak + after;
+        return curvature < 0.0f ? std::max(-0.5f, std::min(0.5f, 0.5f * (before - after) / curvature)) : 0.0f;
+    };
+    float x = float(best.x), y = float(best.y);
+    const float *row = objective.ptr<float>(best.y);
+    if (best.x > 0 && best.x < eye.cols - 1)
+        x += refine(row[best.x - 1], row[best.x], row[best.x + 1]);
+    if (best.y > 0 && best.y < eye.rows - 1)
+        y += refine(objective.at<float>(best.y - 1, best.x), row[best.x], objective.at<float>(best.y + 1, best.x));
+
+    //back to image pixels, centers of the area averaged pixels
+    const float scaleX = float(region.width) / eye.cols, scaleY = float(region.height) / eye.rows;
+    pupil = cv::Point2f(region.x + (x + 0.5f) * scaleX - 0.5f, region.y + (y + 0.5f) * scaleY - 0.5f);
+    return true;
+}
+
+/**
+ * @brief PupilLocator::setUseReference : run the scalar kernel instead of the vector one, for checking
+ * @param reference
+ */
+void PupilLocator::setUseReference(bool reference) {
+    useReference = reference;
+}
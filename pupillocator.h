@@ -0,0 +1,30 @@
+#ifndef PUPILLOCATOR_H
+#define PUPILLOCATOR_H
+
+#include <opencv2/core.hpp>
+
+/**
+ * @brief The PupilLocator class : finds both pupil centers inside a face without an eye cascade.
+ * The eye regions come from the proportions of the face, the pupil is the center the image gradients of the region
+ * point away from (PupilKernels), weighted by darkness. Sub-pixel, and much cheaper than a cascade run.
+ */
+class PupilLocator
+{
+public:
+    static cv::Rect eyeRegion(const cv::Rect &face, bool leftEye);
+
+    bool locate(const cv::Mat &gray, const cv::Rect &face, cv::Point2f &leftPupil, cv::Point2f &rightPupil);
+    bool locateInRegion(const cv::Mat &gray, const cv::Rect &region, cv::Point2f &pupil);
+
+    void setUseReference(bool reference);
+
+private:
+    cv::Mat eye;
+    cv::Mat smoothed;
+    cv::Mat gradientX, gradientY, magnitude;
+    cv::Mat weight;
+    cv::Mat objective;
+    bool useReference = false;
+};
+
+#endif // PUPILLOCATOR_H
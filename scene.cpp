@@ -0,0 +1,227 @@
+#include "scene.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#include <numeric>
+
+/**
+ * @brief vectorOf : a JSON [x, y, z] array, or a single number for all three
+ */
+static QVector3D vectorOf(const QJsonValue &value, float fallback) {
+    if (value.isDouble())
+        return QVector3D(1.0f, 1.0f, 1.0f) * float(value.toDouble());
+    const QJsonArray array = value.toArray();
+    if (array.size() != 3)
+        return QVector3D(fallback, fallback, fallback);
+    return QVector3D(float(array[0].toDouble()), float(array[1].toDouble()), float(array[2].toDouble()));
+}
+
+/**
+ * @brief Scene::load : replace the scene with the one described in a JSON file:
+ * "meshes": [{"name", "file" (OBJ), "texture", "insideOut"}],
+ * "objects": [{"mesh", "position", "rotation" (degrees about x, then y, then z), "scale", "fitScreen"}].
+ * Relative paths are relative to the scene file, fitScreen objects are scaled by the screen half size in x and y.
+ * @param path : resource or file
+ * @return false if the file, or a mesh it names, can't be read
+ */
+bool Scene::load(const QString &path) {
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly)) {
+        qDebug() << "Can't read scene" << path;
+        return false;
+    }
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    if (!document.isObject()) {
+        qDebug() << "Can't parse scene" << path << error.errorString();
+        return false;
+    }
+
+    clear();
+    const QDir dir = QFileInfo(path).dir();
+    const QJsonObject root = document.object();
+
+    for (const QJsonValue &value : root["meshes"].toArray()) {
+        const QJsonObject mesh = value.toObject();
+        MeshData data;
+        if (!MeshFile::read(dir.filePath(mesh["file"].toString()), data))
+            return false;
+        addMesh(mesh["name"].toString(), data, dir.filePath(mesh["texture"].toString()), mesh["insideOut"].toBool());
+    }
+
+    for (const QJsonValue &value : root["objects"].toArray()) {
+        const QJsonObject object = value.toObject();
+        const int mesh = findMesh(object["mesh"].toString());
+        if (mesh < 0) {
+            qDebug() << "Scene object of an unknown mesh" << object["mesh"].toString();
+            return false;
+        }
+
+        const QVector3D rotation = vectorOf(object["rotation"], 0.0f);
+        QMatrix4x4 transform;
+        transform.translate(vectorOf(object["position"], 0.0f));
+        transform.rotate(rotation.x(), QVector3D(1.0f, 0.0f, 0.0f));
+        transform.rotate(rotation.y(), QVector3D(0.0f, 1.0f, 0.0f));
+        transform.rotate(rotation.z(), QVector3D(0.0f, 0.0f, 1.0f));
+        transform.scale(vectorOf(object["scale"], 1.0f));
+        addObject(mesh, transform, object["fitScreen"].toBool());
+    }
+    return true;
+}
+
+/**
+ * @brief Scene::clear : remove every mesh and object
+ */
+void Scene::clear() {
+    batches.clear();
+}
+
+/**
+ * @brief Scene::addMesh : add a mesh objects can be made of, before the renderer is initialized
+ * @param name
+ * @param mesh
+ * @param texture : image resource or file
+ * @param insideOut : true for meshes seen from inside
+ * @return its index
+ */
+int Scene::addMesh(const QString &name, const MeshData &mesh, const QString &texture, bool insideOut) {
+    Batch batch;
+    batch.name = name;
+    batch.texture = texture;
+    batch.insideOut = insideOut;
+    batch.mesh = mesh;
+    batches.push_back(batch);
+    return int(batches.size()) - 1;
+}
+
+/**
+ * @brief Scene::findMesh
+ * @param name
+ * @return index of the mesh, -1 if there is none of that name
+ */
+int Scene::findMesh(const QString &name) const {
+    for (size_t i = 0; i < batches.size(); i++)
+        if (batches[i].name == name)
+            return int(i);
+    return -1;
+}
+
+/**
+ * @brief Scene::addObject : place one more instance of a mesh, objects can be added at any time
+ * @param mesh : index from addMesh()
+ * @param transform : model matrix, affine
+ * @param fitScreen : scale it by the screen half size in x and y, for the box around the scene
+ * @return false if there is no such mesh
+ */
+bool Scene::addObject(int mesh, const QMatrix4x4 &transform, bool fitScreen) {
+    if (mesh < 0 || mesh >= int(batches.size()))
+        return false;
+
+    Batch &batch = batches[mesh];
+    batch.placements.push_back(transform);
+    batch.fitScreen.push_back(fitScreen);
+    batch.centerX.push_back(0.0f);
+    batch.centerY.push_back(0.0f);
+    batch.centerZ.push_back(0.0f);
+    batch.radius.push_back(0.0f);
+    for (std::vector<QVector4D> &row : batch.rows)
+        row.push_back(QVector4D());
+    batch.visible.push_back(0);
+    place(batch, batch.instanceCount() - 1);
+    return true;
+}
+
+/**
+ * @brief Scene::setScreenSize : refit the objects that follow the screen
+ * @param halfWidth : half the screen width in scene units
+ * @param halfHeight
+ */
+void Scene::setScreenSize(float halfWidth, float halfHeight) {
+    screenWidth = halfWidth;
+    screenHeight = halfHeight;
+    for (Batch &batch : batches)
+        for (int i = 0; i < batch.instanceCount(); i++)
+            if (batch.fitScreen[i])
+                place(batch, i);
+}
+
+/**
+ * @brief Scene::setCulling
+ * @param enabled : false keeps every object, to measure what the culling saves
+ */
+void Scene::setCulling(bool enabled) {
+    culling = enabled;
+}
+
+/**
+ * @brief Scene::cull : find the objects the frame will show, into the visible list of each batch
+ * @param viewProjections : one matrix per eye
+ * @param views : 1 for mono, 2 for stereo
+ * @return number of visible objects
+ */
+int Scene::cull(const QMatrix4x4 *viewProjections, int views) {
+    culler.setFrustums(viewProjections, views);
+    int total = 0;
+    for (Batch &batch : batches) {
+        if (culling) {
+            batch.visibleCount = culler.cull(batch.centerX.data(), batch.centerY.data(), batch.centerZ.data(),
+                                             batch.radius.data(), batch.instanceCount(), batch.visible.data());
+        } else {
+            std::iota(batch.visible.begin(), batch.visible.end(), 0);
+            batch.visibleCount = batch.instanceCount();
+        }
+        total += batch.visibleCount;
+    }
+    return total;
+}
+
+/**
+ * @brief Scene::getBatches
+ * @return one batch per mesh, in the order they were added
+ */
+const std::vector<Scene::Batch> &Scene::getBatches() const {
+    return batches;
+}
+
+/**
+ * @brief Scene::objectCount
+ * @return objects of every mesh
+ */
+int Scene::objectCount() const {
+    int count = 0;
+    for (const Batch &batch : batches)
+        count += batch.instanceCount();
+    return count;
+}
+
+/**
+ * @brief Scene::place : derive the model matrix rows and the bounding sphere of an instance from its placement
+ * @param batch
+ * @param instance
+ */
+void Scene::place(Batch &batch, int instance) {
+    QMatrix4x4 model = batch.placements[instance];
+    if (batch.fitScreen[instance]) {
+        QMatrix4x4 fit;
+        fit.scale(screenWidth, screenHeight, 1.0f);
+        model = fit * model;
+    }
+    for (int r = 0; r < 3; r++)
+        batch.rows[r][instance] = model.row(r);
+
+    //the sphere grows with the largest scale of the three axes
+    float scale = 0.0f;
+    for (int c = 0; c < 3; c++)
+        scale = std::max(scale, model.column(c).toVector3D().length());
+
+    const QVector3D center = model.map(batch.mesh.center);
+    batch.centerX[instance] = center.x();
+    batch.centerY[instance] = center.y();
+    batch.centerZ[instance] = center.z();
+    batch.radius[instance] = batch.mesh.radius * scale;
+}
@@ -0,0 +1,63 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <QMatrix4x4>
+#include <QString>
+#include <QVector4D>
+#include <vector>
+#include "frustumculler.h"
+#include "meshfile.h"
+
+/**
+ * @brief The Scene class : the meshes in the head-coupled box and the objects placed with them. Objects of the same
+ * mesh form a batch drawn at once, each batch keeps its instances as structure of arrays: the bounding spheres
+ * the culling reads every frame, apart from the model matrix rows the GPU reads for the visible ones.
+ */
+class Scene
+{
+public:
+    struct Batch
+    {
+        QString name;
+        QString texture;
+        bool insideOut = false;     // seen from inside, like the walls of the box: front faces culled
+        MeshData mesh;
+
+        // one entry per instance
+        std::vector<float> centerX, centerY, centerZ, radius;
+        std::vector<QVector4D> rows[3];     // first three rows of the model matrix, the last is 0 0 0 1
+        std::vector<QMatrix4x4> placements; // as given, before fitting to the screen
+        std::vector<char> fitScreen;
+
+        // indices of the instances that passed the last cull
+        std::vector<int> visible;
+        int visibleCount = 0;
+
+        int instanceCount() const { return int(placements.size()); }
+    };
+
+    bool load(const QString &path);
+    void clear();
+
+    int addMesh(const QString &name, const MeshData &mesh, const QString &texture, bool insideOut = false);
+    int findMesh(const QString &name) const;
+    bool addObject(int mesh, const QMatrix4x4 &transform, bool fitScreen = false);
+
+    void setScreenSize(float halfWidth, float halfHeight);
+    void setCulling(bool enabled);
+    int cull(const QMatrix4x4 *viewProjections, int views);
+
+    const std::vector<Batch> &getBatches() const;
+    int objectCount() const;
+
+private:
+    void place(Batch &batch, int instance);
+
+private:
+    std::vector<Batch> batches;
+    FrustumCuller culler;
+    bool culling = true;
+    float screenWidth = 1.0f, screenHeight = 1.0f;
+};
+
+#endif // SCENE_H
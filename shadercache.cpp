@@ -0,0 +1,162 @@
+#include "shadercache.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+#include "monotonicclock.h"
+
+// GL 4.1, GLES 3 and OES_get_program_binary, resolved at run time so GLES 2 headers do for the build
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+
+typedef void (QOPENGLF_APIENTRYP GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *format, void *binary);
+typedef void (QOPENGLF_APIENTRYP ProgramBinary)(GLuint program, GLenum format, const void *binary, GLsizei length);
+typedef void (QOPENGLF_APIENTRYP ProgramParameteri)(GLuint program, GLenum name, GLint value);
+
+static const char magic[4] = {'H', 'C', 'P', 'S'};
+
+/**
+ * @brief The ProgramBinaryFunctions struct : the program binary entry points of the current context, null if missing
+ */
+struct ProgramBinaryFunctions
+{
+    GetProgramBinary getProgramBinary = nullptr;
+    ProgramBinary programBinary = nullptr;
+    ProgramParameteri programParameteri = nullptr;
+
+    explicit ProgramBinaryFunctions(QOpenGLContext *context) {
+        GLint formats = 0;
+        context->functions()->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        context->functions()->glGetError(); //GL_INVALID_ENUM where the query itself is unknown
+        if (formats <= 0)
+            return;
+
+        const bool oes = context->isOpenGLES() && context->format().majorVersion() < 3;
+        getProgramBinary = reinterpret_cast<GetProgramBinary>(context->getProcAddress(oes ? "glGetProgramBinaryOES" : "glGetProgramBinary"));
+        programBinary = reinterpret_cast<ProgramBinary>(context->getProcAddress(oes ? "glProgramBinaryOES" : "glProgramBinary"));
+        if (!oes)
+            programParameteri = reinterpret_cast<ProgramParameteri>(context->getProcAddress("glProgramParameteri"));
+    }
+
+    bool supported() const { return getProgramBinary && programBinary; }
+};
+
+/**
+ * @brief ShaderCache::build : build a program from the cache or from its sources, the context must be current
+ * @param program : not linked yet, attribute locations bound beforehand are kept
+ * @param name : names the cache file
+ * @param vertexFile : vertex shader source, resource or file
+ * @param fragmentFile : fragment shader source
+ * @param report : receives where the program came from and the time spent
+ * @param preamble : put before both sources, the #version line of shaders written for more than one GLSL version
+ * @return true if the program is linked
+ */
+bool ShaderCache::build(QOpenGLShaderProgram &program, const QString &name, const QString &vertexFile,
+                        const QString &fragmentFile, Report *report, const QByteArray &preamble) {
+    Report local;
+    Report &r = report ? *report : local;
+    r = Report();
+
+    QFile vertexSource(vertexFile), fragmentSource(fragmentFile);
+    if (!vertexSource.open(QFile::ReadOnly) || !fragmentSource.open(QFile::ReadOnly)) {
+        qDebug() << "Can't read shader sources" << vertexFile << fragmentFile;
+        return false;
+    }
+    const QByteArray vertex = preamble + vertexSource.readAll(), fragment = preamble + fragmentSource.readAll();
+
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    QOpenGLFunctions *gl = context->functions();
+    ProgramBinaryFunctions binary(context);
+    r.binarySupported = binary.supported();
+
+    if (!program.create())
+        return false;
+
+    //the binary is only valid for the same sources on the same driver
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(vertex);
+    hash.addData(fragment);
+    for (GLenum string : {GLenum(GL_VENDOR), GLenum(GL_RENDERER), GLenum(GL_VERSION)})
+        hash.addData(QByteArray(reinterpret_cast<const char *>(gl->glGetString(string))));
+    r.path = r.binarySupported ? cachePath(name, hash.result()) : QString();
+
+    qint64 start = monotonicNs();
+    QFile cached(r.path);
+    if (!r.path.isEmpty() && cached.open(QFile::ReadOnly)) {
+        const QByteArray data = cached.readAll();
+        GLenum format;
+        if (data.size() > int(sizeof(magic) + sizeof(format)) && !memcmp(data.constData(), magic, sizeof(magic))) {
+            memcpy(&format, data.constData() + sizeof(magic), sizeof(format));
+            const int offset = int(sizeof(magic) + sizeof(format));
+            binary.programBinary(program.programId(), format, data.constData() + offset, data.size() - offset);
+            r.cacheHit = program.link(); //no shaders attached: only checks the link status of the binary
+        }
+        if (!r.cacheHit) {
+            qDebug() << "Discarding shader cache refused by the driver" << r.path;
+            cached.close();
+            cached.remove();
+        }
+    }
+    r.loadMs = (monotonicNs() - start) / 1e6;
+    if (r.cacheHit)
+        return true;
+
+    start = monotonicNs();
+    if (binary.programParameteri)
+        binary.programParameteri(program.programId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    if (!program.addShaderFromSourceCode(QOpenGLShader::Vertex, vertex)) {
+        qDebug() << "\nVERTEX SHADER ERROR\n";
+        return false;
+    }
+    if (!program.addShaderFromSourceCode(QOpenGLShader::Fragment, fragment)) {
+        qDebug() << "\nFRAGMENT SHADER ERROR\n";
+        return false;
+    }
+    if (!program.link()) {
+        qDebug() << "\nLINKING SHADERS ERROR\n";
+        return false;
+    }
+    r.compileMs = (monotonicNs() - start) / 1e6;
+
+    if (r.path.isEmpty() || !QDir().mkpath(QFileInfo(r.path).path()))
+        return true;
+
+    start = monotonicNs();
+    GLint length = 0;
+    gl->glGetProgramiv(program.programId(), GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length > 0) {
+        QByteArray data(int(sizeof(magic) + sizeof(GLenum)) + length, Qt::Uninitialized);
+        GLenum format = 0;
+        GLsizei written = 0;
+        binary.getProgramBinary(program.programId(), length, &written, &format, data.data() + sizeof(magic) + sizeof(format));
+        memcpy(data.data(), magic, sizeof(magic));
+        memcpy(data.data() + sizeof(magic), &format, sizeof(format));
+        data.resize(int(sizeof(magic) + sizeof(format)) + written);
+
+        QSaveFile out(r.path);
+        if (!written || !out.open(QFile::WriteOnly) || out.write(data) < 0 || !out.commit())
+            qDebug() << "Can't write shader cache" << r.path;
+    }
+    r.storeMs = (monotonicNs() - start) / 1e6;
+    return true;
+}
+
+/**
+ * @brief ShaderCache::cachePath : where the binary of a program is kept
+ * @param name : program name
+ * @param key : hash of the sources and the driver
+ * @return the path, empty if the platform has no app data directory
+ */
+QString ShaderCache::cachePath(const QString &name, const QByteArray &key) {
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (dir.isEmpty())
+        return QString();
+    return QString("%1/shaders/%2-%3.bin").arg(dir, name, QString::fromLatin1(key.toHex().left(16)));
+}
@@ -0,0 +1,31 @@
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include <QByteArray>
+#include <QOpenGLShaderProgram>
+#include <QString>
+
+/**
+ * @brief The ShaderCache class : builds shader programs from the linked binaries of an earlier run when the driver
+ * supports program binaries, and from source otherwise. The binaries are kept in the app data directory, keyed by the
+ * sources and the driver, a binary the driver refuses is rebuilt from source and replaced.
+ */
+class ShaderCache
+{
+public:
+    struct Report
+    {
+        bool binarySupported = false;
+        bool cacheHit = false;
+        double loadMs = 0.0;    // reading the cache and handing the binary to the driver, hit or not
+        double compileMs = 0.0; // compiling and linking from source, 0 on a hit
+        double storeMs = 0.0;   // fetching the binary from the driver and writing it
+        QString path;
+    };
+
+    static bool build(QOpenGLShaderProgram &program, const QString &name, const QString &vertexFile,
+                      const QString &fragmentFile, Report *report = nullptr, const QByteArray &preamble = QByteArray());
+    static QString cachePath(const QString &name, const QByteArray &key);
+};
+
+#endif // SHADERCACHE_H
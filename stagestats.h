@@ -0,0 +1,72 @@
+#ifndef STAGESTATS_H
+#define STAGESTATS_H
+
+#include "hotpathtrace.h"
+#include "monotonicclock.h"
+#include <QElapsedTimer>
+#include <atomic>
+
+/**
+ * @brief The StageStats class : lock-free timing counters for one pipeline stage.
+ * Written by the thread running the stage, readable from any other thread.
+ */
+class StageStats
+{
+public:
+    StageStats() {
+        clock.start();
+    }
+
+    void record(qint64 elapsedNs) {
+        samples.fetch_add(1, std::memory_order_relaxed);
+        totalNs.fetch_add(elapsedNs, std::memory_order_relaxed);
+        lastNs.store(elapsedNs, std::memory_order_relaxed);
+        qint64 max = maxNs.load(std::memory_order_relaxed);
+        while (elapsedNs > max && !maxNs.compare_exchange_weak(max, elapsedNs, std::memory_order_relaxed)) {}
+    }
+
+    quint64 count() const { return samples.load(std::memory_order_relaxed); }
+    double lastMs() const { return lastNs.load(std::memory_order_relaxed) / 1e6; }
+    double maxMs() const { return maxNs.load(std::memory_order_relaxed) / 1e6; }
+
+    double averageMs() const {
+        quint64 n = count();
+        return n ? totalNs.load(std::memory_order_relaxed) / 1e6 / n : 0.0;
+    }
+
+    //samples per second since construction
+    double throughput() const {
+        qint64 elapsed = clock.nsecsElapsed();
+        return elapsed > 0 ? count() * 1e9 / elapsed : 0.0;
+    }
+
+private:
+    QElapsedTimer clock;
+    std::atomic<quint64> samples{0};
+    std::atomic<qint64> totalNs{0};
+    std::atomic<qint64> lastNs{0};
+    std::atomic<qint64> maxNs{0};
+};
+
+/**
+ * @brief The ScopedStageTimer class : records the lifetime of the scope into a StageStats,
+ * and into the hot path trace when a trace stage is given
+ */
+class ScopedStageTimer
+{
+public:
+    explicit ScopedStageTimer(StageStats &stats, HotPathTrace::Stage stage = HotPathTrace::None)
+        : stats(stats), stage(stage), startNs(monotonicNs()) {}
+    ~ScopedStageTimer() {
+        qint64 elapsed = monotonicNs() - startNs;
+        stats.record(elapsed);
+        HotPathTrace::record(stage, startNs, elapsed);
+    }
+
+private:
+    StageStats &stats;
+    HotPathTrace::Stage stage;
+    qint64 startNs;
+};
+
+#endif // STAGESTATS_H
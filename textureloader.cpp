@@ -0,0 +1,190 @@
+#include "textureloader.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include "monotonicclock.h"
+
+static const quint32 glUnsignedByte = 0x1401;
+static const quint32 glRgba = 0x1908;
+static const quint32 glRgba8 = 0x8058;
+static const int maxTextureSize = 1024;
+
+/**
+ * @brief The TextureJob class : one texture prepared on the loader's pool
+ */
+class TextureJob : public QRunnable
+{
+public:
+    TextureJob(TextureLoader *loader, const QString &resource, const QVector<quint32> &formats) :
+        loader(loader), resource(resource), formats(formats) {}
+
+    void run() override {
+        loader->prepare(resource, formats);
+    }
+
+private:
+    TextureLoader *loader;
+    QString resource;
+    QVector<quint32> formats;
+};
+
+/**
+ * @brief powerOfTwo : the power of two closest to a size, mip chains of any length and compressed blocks need it
+ * @param size
+ * @return
+ */
+static int powerOfTwo(int size) {
+    int power = 1;
+    while (power * 2 <= size)
+        power *= 2;
+    return qMin(maxTextureSize, size - power > power * 2 - size ? power * 2 : power);
+}
+
+/**
+ * @brief TextureLoader::TextureLoader : constructor, one background thread, the textures are prepared in turn
+ * @param parent
+ */
+TextureLoader::TextureLoader(QObject *parent) :
+    QObject(parent)
+{
+    pool.setMaxThreadCount(1);
+}
+
+TextureLoader::~TextureLoader()
+{
+    pool.waitForDone();
+}
+
+/**
+ * @brief TextureLoader::setCompressedFormats : the compressed internal formats the GL context can sample,
+ * for the textures loaded from now on
+ * @param formats
+ */
+void TextureLoader::setCompressedFormats(const QVector<quint32> &formats) {
+    compressedFormats = formats;
+}
+
+/**
+ * @brief TextureLoader::load : start preparing a texture, textureReady() is emitted when take() can have it
+ * @param resource : image in the resources or on disk
+ */
+void TextureLoader::load(const QString &resource) {
+    pool.start(new TextureJob(this, resource, compressedFormats));
+}
+
+/**
+ * @brief TextureLoader::take : hand a prepared texture over, thread safe
+ * @param resource : as given to load()
+ * @param texture : receives the texture
+ * @return false if it is not ready yet
+ */
+bool TextureLoader::take(const QString &resource, TextureData &texture) {
+    QMutexLocker locker(&mutex);
+    auto it = ready.find(resource);
+    if (it == ready.end())
+        return false;
+    texture = it.value();
+    ready.erase(it);
+    return true;
+}
+
+/**
+ * @brief TextureLoader::waitForDone : block until every requested texture is prepared
+ */
+void TextureLoader::waitForDone() {
+    pool.waitForDone();
+}
+
+/**
+ * @brief TextureLoader::prepare : runs on the pool
+ * @param resource
+ * @param formats : compressed formats the GL context can sample
+ */
+void TextureLoader::prepare(const QString &resource, const QVector<quint32> &formats) {
+    qint64 start = monotonicNs();
+    TextureData texture;
+    const char *source = "compressed";
+
+    const QFileInfo info(resource);
+    QFile compressed(info.path() + "/" + info.completeBaseName() + ".ktx");
+    if (!compressed.open(QFile::ReadOnly) || !KtxFile::read(compressed.readAll(), texture)
+            || !texture.isCompressed() || !formats.contains(texture.glInternalFormat)) {
+        texture = TextureData();
+        source = "cache";
+
+        const QString cached = cachePath(resource, info.size());
+        QFile cachedFile(cached);
+        if (cached.isEmpty() || !cachedFile.open(QFile::ReadOnly) || !KtxFile::read(cachedFile.readAll(), texture)) {
+            texture = decode(resource);
+            source = "image";
+
+            if (!texture.isEmpty() && !cached.isEmpty() && QDir().mkpath(QFileInfo(cached).path())) {
+                QSaveFile out(cached);
+                if (!out.open(QFile::WriteOnly) || out.write(KtxFile::write(texture)) < 0 || !out.commit())
+                    qDebug() << "Can't write texture cache" << cached;
+            }
+        }
+    }
+
+    if (texture.isEmpty()) {
+        qDebug() << "Can't load texture" << resource;
+        return;
+    }
+    qDebug().nospace() << "Texture " << resource << " " << texture.size.width() << "x" << texture.size.height()
+                       << ", " << texture.levels.size() << " levels, from the " << source << " in "
+                       << (monotonicNs() - start) / 1e6 << " ms";
+    {
+        QMutexLocker locker(&mutex);
+        ready.insert(resource, texture);
+    }
+    emit textureReady(resource);
+}
+
+/**
+ * @brief TextureLoader::decode : decode an image into an RGBA mip chain. The size is rounded to powers of two and the
+ * rows are flipped to the bottom-up order of OpenGL, as QOpenGLTexture::setData(QImage) does.
+ * @param resource : image file
+ * @return the texture, empty if the image can't be read
+ */
+TextureData TextureLoader::decode(const QString &resource) {
+    TextureData texture;
+    QImage image(resource);
+    if (image.isNull())
+        return texture;
+
+    const QSize size(powerOfTwo(image.width()), powerOfTwo(image.height()));
+    image = image.convertToFormat(QImage::Format_RGBA8888).mirrored()
+            .scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+    texture.glInternalFormat = glRgba8;
+    texture.glFormat = glRgba;
+    texture.glType = glUnsignedByte;
+    texture.size = size;
+    for (;;) {
+        texture.levels.append(QByteArray(reinterpret_cast<const char *>(image.constBits()), image.width() * image.height() * 4));
+        if (image.width() == 1 && image.height() == 1)
+            break;
+        image = image.scaled(qMax(1, image.width() / 2), qMax(1, image.height() / 2), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    return texture;
+}
+
+/**
+ * @brief TextureLoader::cachePath : where the mip chain of a resource is kept, named like the cascade cache
+ * @param resource
+ * @param resourceSize
+ * @return the path, empty if the platform has no app data directory
+ */
+QString TextureLoader::cachePath(const QString &resource, qint64 resourceSize) {
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (dir.isEmpty())
+        return QString();
+    return QString("%1/textures/%2-%3-%4.ktx").arg(dir, QFileInfo(resource).completeBaseName())
+            .arg(resourceSize).arg(QCoreApplication::applicationVersion());
+}
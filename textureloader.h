@@ -0,0 +1,47 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+#include "ktxfile.h"
+
+/**
+ * @brief The TextureLoader class : prepares textures with their mip chain on a background thread, the GL thread only
+ * uploads them. For an image resource "name.jpg" it uses, in this order:
+ * a compressed "name.ktx" next to it if the GL context can sample its format,
+ * the RGBA mip chain cached in the app data directory by an earlier run,
+ * or decodes the image, builds the mip chain and fills that cache.
+ */
+class TextureLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TextureLoader(QObject *parent = nullptr);
+    ~TextureLoader() override;
+
+    void setCompressedFormats(const QVector<quint32> &formats);
+    void load(const QString &resource);
+    bool take(const QString &resource, TextureData &texture);
+    void waitForDone();
+
+    static TextureData decode(const QString &resource);
+    static QString cachePath(const QString &resource, qint64 resourceSize);
+
+signals:
+    void textureReady(const QString &resource);
+
+private:
+    friend class TextureJob;
+    void prepare(const QString &resource, const QVector<quint32> &formats);
+
+private:
+    QThreadPool pool;
+    QMutex mutex;
+    QHash<QString, TextureData> ready;
+    QVector<quint32> compressedFormats;
+};
+
+#endif // TEXTURELOADER_H
@@ -0,0 +1,50 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+/**
+ * @brief The TripleBuffer class : wait-free hand-off of the latest value from one writer thread to one reader thread.
+ * The writer fills a private back slot and swaps it with the shared middle slot, the reader swaps the middle
+ * slot with its private front slot when a new value is there. Neither side ever blocks or sees a half written value.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    //writer side
+    void publish(const T &value) {
+        buffers[backIndex] = value;
+        unsigned char previous = middle.exchange(backIndex | freshBit, std::memory_order_acq_rel);
+        backIndex = previous & indexMask;
+    }
+
+    //reader side: true if a value newer than the last read was published
+    bool hasNew() const {
+        return middle.load(std::memory_order_acquire) & freshBit;
+    }
+
+    //reader side: the most recently published value
+    const T &read() {
+        if (middle.load(std::memory_order_relaxed) & freshBit) {
+            unsigned char previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+            frontIndex = previous & indexMask;
+        }
+        return buffers[frontIndex];
+    }
+
+private:
+    static const unsigned char indexMask = 0x3;
+    static const unsigned char freshBit = 0x4;
+
+    T buffers[3];
+    unsigned char frontIndex = 0;
+    unsigned char backIndex = 2;
+    std::atomic<unsigned char> middle{1};
+};
+
+#endif // TRIPLEBUFFER_H
@@ -4,8 +4,7 @@ precision mediump int;
 precision mediump float;
 #endif
 
-uniform mat4 viewFrustrum;
-uniform mat4 transform;
+uniform mat4 mvp;
 
 attribute vec3 aPosition;
 attribute vec2 aTexCoord;
@@ -15,7 +14,7 @@ varying vec2 vTexCoord;
 void main()
 {
     // Calculate vertex position in screen space
-    gl_Position = viewFrustrum * transform * vec4(aPosition, 1.0);
+    gl_Position = mvp * vec4(aPosition, 1.0);
 
     vTexCoord = aTexCoord;
 }
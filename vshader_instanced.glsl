@@ -0,0 +1,44 @@
+// Every visible object of a mesh in one draw, the model matrix comes per instance.
+// With STEREO defined each object is drawn for both eyes: instance 2i for the left eye, 2i + 1 for the right eye.
+// Each eye is clipped to its half of the target by gl_ClipDistance 0 and 1, which the renderer enables.
+// Compiled as GLSL ES 3.00 or GLSL 3.30, the #version line is added by the renderer.
+#ifdef GL_ES
+precision mediump int;
+precision highp float;
+#endif
+
+uniform mat4 viewProjection[2];
+
+in vec3 aPosition;
+in vec2 aTexCoord;
+
+// First three rows of the model matrix, the last is 0 0 0 1
+in vec4 aModel0;
+in vec4 aModel1;
+in vec4 aModel2;
+
+out vec2 vTexCoord;
+
+void main()
+{
+    vec4 local = vec4(aPosition, 1.0);
+    vec4 world = vec4(dot(aModel0, local), dot(aModel1, local), dot(aModel2, local), 1.0);
+
+#ifdef STEREO
+    int eye = gl_InstanceID % 2;
+    vec4 position = viewProjection[eye] * world;
+
+    // Clipping only stops at the edges of the whole target: clip against the sides of this eye's own view,
+    // so nothing it draws reaches into the other eye's half
+    gl_ClipDistance[0] = position.w + position.x;
+    gl_ClipDistance[1] = position.w - position.x;
+
+    // Squeeze the view into the left or right half of the target
+    position.x = position.x * 0.5 + (float(eye) - 0.5) * position.w;
+    gl_Position = position;
+#else
+    gl_Position = viewProjection[0] * world;
+#endif
+
+    vTexCoord = aTexCoord;
+}